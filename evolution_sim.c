@@ -4,18 +4,45 @@
 #include <stdlib.h>
 #include <time.h>
 #include <stdio.h>
+#include <stdarg.h>
+#include <string.h>
+#include <signal.h>
+#include <errno.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <sched.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#endif
 
 // Core simulation parameters
 #define POP_SIZE 5 // Initial population size
 #define INPUTS 17  // Neural network input count
-#define HIDDEN 10  // Hidden layer neuron count
+#define HIDDEN 10  // Default hidden layer neuron count
 #define OUTPUTS 2  // Output neuron count (X and Y movement)
 
+// Runtime network topology limits
+#define MAX_LAYERS 8         // Input + hidden + output layers
+#define MAX_LAYER_WIDTH 256  // Widest supported layer
+
 // Starting energy levels for different species
 #define WOLF_STARTENERGY 150
 #define FOX_STARTENERGY 120
 #define DUCK_STARTENERGY 80
 #define RABBIT_STARTENERGY 50
+#define GRASS_ENERGY 30
 
 // Reproduction age for different species
 #define WOLF_REPRODUCTIONAGE 15000
@@ -33,12 +60,77 @@
 #define WINDOW_WIDTH 1920
 #define WINDOW_HEIGHT 1000
 
+// Distance at which creatures eat or mate
+#define INTERACTION_RANGE 24.0f
+
+// Distance at which creatures sense food, predators and mates
+#define MAX_DETECTION_RANGE 1000.0f
+
+// Contacts kept per creature by the neighbour sweep (more falls back to a rescan)
+#define MAX_CONTACTS 16
+
+// Worker pool
+#define MAX_WORKERS 64      // Upper bound on worker threads
+
+// Morton-order reordering of creature storage
+#define REORDER_CHECK_INTERVAL 64    // Ticks between drift measurements
+#define REORDER_DRIFT_THRESHOLD 0.2f // Reorder once this fraction of neighbours in memory is out of Z-order
+#define MAX_CREATURE_HANDLES 8       // External Creature pointers fixed up after a reorder
+#define RADIX_BLOCK 4096             // Keys per block in the parallel radix sort
+
+// Preallocated creature pool (--pool)
+#define POOL_SLOT_ALIGN 64       // Genome slots start on a cache line
+#define HUGE_PAGE_SIZE (2 << 20) // Pool mapping rounded up to whole huge pages
+
+// Grass spawn chance per tick
+#define GRASS_SPAWN_CHANCE 0.06f
+
+// Tick budget governor (interactive mode)
+#define DEFAULT_FRAME_BUDGET_MS 16.0f // Target time for simulation and drawing per frame
+#define MAX_TICKS_PER_FRAME 8         // Upper bound on simulation ticks per frame
+#define GOVERNOR_INTERVAL 15          // Frames between governor adjustments
+#define GOVERNOR_LOG_INTERVAL 1.0     // Seconds between governor log lines
+#define MIN_GRASS_SPAWN_SCALE 0.05f   // Lowest grass spawn rate the governor applies
+
+// Population history (fixed memory however long the run)
+#define HISTORY_LEVELS 6   // Level n buckets cover HISTORY_FANOUT^n ticks
+#define HISTORY_LENGTH 512 // Buckets kept per level
+#define HISTORY_FANOUT 8   // Buckets of one level folded into one bucket of the next
+
 // Max hearth effects
 #define MAX_HEARTH_EFFECTS 100
 
 // Mutation chance for neural network weights
 #define MUTATION_CHANCE 0.07f
 
+// Number of entries in the Species enum
+#define SPECIES_COUNT 5
+
+// Population statistics
+#define STATS_RESYNC_INTERVAL 4096 // Ticks between exact recounts of the running sums
+#define DIVERSITY_INTERVAL 600     // Ticks between brain snapshots for diversity metrics
+#define DIVERSITY_SAMPLE 512       // Maximum brains sampled per species
+#define DIVERSITY_PAIRS 4096       // Random pairs used for the mean pairwise distance
+#define MAX_STRATEGIES 6           // Most brain clusters (behavioural strategies) reported per species
+#define STRATEGY_MIN_SILHOUETTE 0.25f // Clusterings with a weaker mean silhouette count as one strategy
+#define KMEDOIDS_ITERATIONS 10     // Medoid update rounds per clustering
+#define STRATEGY_TINT_BUDGET 2000000 // Genome floats compared per frame when re-matching creatures to new medoids
+
+// Frame capture
+#define CAPTURE_QUEUE_SIZE 8 // Frames waiting for the encoder before new ones are dropped
+#define CAPTURE_CELL 4       // World pixels per heatmap pixel in headless capture
+
+// Metrics endpoint buffer sizes
+#define METRICS_REQUEST_SIZE 2048
+#define METRICS_RESPONSE_SIZE 16384
+
+// Sharded world (one process per tile)
+#define MAX_TILE_AXIS 8        // Most tiles along each axis
+#define MAX_TILES 64           // MAX_TILE_AXIS squared
+#define GHOST_BAND 200.0f      // Border strip mirrored into neighbouring tiles
+#define GHOST_RING_SIZE 4096   // Ghost records per tile side and tick
+#define MIGRANT_RING_SIZE 256  // Migrating creatures per tile side and tick
+
 // Species Types - defines the ecological role of each creature
 typedef enum
 {
@@ -49,15 +141,74 @@ typedef enum
     GRASS   // Producer, food for herbivores
 } Species;
 
+// Bit of a species in a food web mask
+#define SPECIES_BIT(species) (1u << (species))
+
+// Food web entry and parameters of one species
+typedef struct
+{
+    const char *name;          // Metrics label
+    const char *label;         // Overlay label
+    unsigned int dietMask;     // Species this one eats
+    unsigned int predatorMask; // Species that eat this one (derived from the diets by SetupFoodWeb())
+    float startEnergy;
+    float speed;               // Base speed of spawned creatures (a little random variation is added)
+    float placedSpeed;         // Speed of creatures placed with the mouse
+    int reproductionAge;       // Age and ticks since mating needed to reproduce (0 = never reproduces)
+    float energyCost;          // Energy per unit of movement
+    Color color;
+    const char *iconPath;
+} SpeciesInfo;
+
+// Kinds of simulation objects whose allocations are tracked
+typedef enum
+{
+    ALLOC_CREATURE, // Animal Creature structs
+    ALLOC_GRASS,    // Grass Creature structs
+    ALLOC_GENOME,   // Neural network genomes
+    ALLOC_NODE,     // Creature list nodes
+    ALLOC_KIND_COUNT
+} AllocKind;
+
+// Allocation counters per object kind (simulation thread only)
+typedef struct
+{
+    long long allocs[ALLOC_KIND_COUNT];    // Allocations so far
+    long long frees[ALLOC_KIND_COUNT];     // Frees so far
+    long long liveBytes[ALLOC_KIND_COUNT]; // Bytes currently allocated
+    long long peakLiveBytes;               // Highest total of liveBytes seen
+} AllocStats;
+
+// Fixed-capacity pool of equal-sized slots with a stack of free slot indices
+typedef struct
+{
+    unsigned char *base; // capacity slots of slotSize bytes
+    size_t slotSize;
+    int capacity;
+    int *freeSlots;      // Indices of the free slots, lowest on top
+    int freeCount;
+} ObjectPool;
+
 // Neural Network Structure - the "brain" of each creature
+// The genome is a flat buffer laid out by the global topology: for each layer,
+// weights[out][in] followed by bias[out]
 typedef struct
 {
-    float weightsIH[HIDDEN][INPUTS];  // Input -> Hidden layer weights
-    float weightsHO[OUTPUTS][HIDDEN]; // Hidden -> Output layer weights
-    float biasH[HIDDEN];              // Hidden layer bias values
-    float biasO[OUTPUTS];             // Output layer bias values
+    float *genes; // topology.genomeLength values (NULL for grass)
 } NeuralNetwork;
 
+// Dense layer kernel: out[o] = Activate(bias[o] + sum(weights[o][i] * in[i]))
+typedef void (*LayerKernel)(const float *layer, const float *in, float *out, int inSize, int outSize);
+
+// Network shape chosen at startup and shared by every brain
+typedef struct
+{
+    int layerCount;                 // Including input and output layers
+    int sizes[MAX_LAYERS];          // Neurons per layer
+    LayerKernel kernels[MAX_LAYERS]; // Kernel computing layer i from layer i - 1
+    int genomeLength;               // Floats per brain
+} NetworkTopology;
+
 // Creature Structure - represents an individual in the simulation
 typedef struct
 {
@@ -69,6 +220,9 @@ typedef struct
     NeuralNetwork brain; // Neural network for decision making
     Color color;         // Visual representation color
     int last_mate;       // Last mate
+    unsigned long long id; // Unique, increasing in creation order (interaction tie-break)
+    unsigned int strategyEpoch; // Clustering the strategy field was computed against (0 = none)
+    unsigned char strategy;     // Nearest strategy medoid of the species, largest strategy first
 } Creature;
 
 typedef struct
@@ -77,6 +231,253 @@ typedef struct
     int age;
 } HearthEffect;
 
+// Running per-species sums, updated as creatures are created, destroyed and changed
+typedef struct
+{
+    int count[SPECIES_COUNT];
+    double energySum[SPECIES_COUNT];
+    double energySumSq[SPECIES_COUNT];
+    double ageSum[SPECIES_COUNT];
+    double ageSumSq[SPECIES_COUNT];
+    double speedSum[SPECIES_COUNT];
+    double speedSumSq[SPECIES_COUNT];
+} PopulationStats;
+
+// Genetic diversity of the sampled brains of each species
+typedef struct
+{
+    int samples[SPECIES_COUNT];            // Brains sampled
+    float weightVariance[SPECIES_COUNT];   // Per-weight variance, averaged over all weights
+    float pairwiseDistance[SPECIES_COUNT]; // Mean Euclidean distance between sampled pairs
+    int strategies[SPECIES_COUNT];         // Brain clusters found in the sample (1 = a single strategy)
+    int strategySizes[SPECIES_COUNT][MAX_STRATEGIES]; // Estimated creatures per strategy, largest first
+    long long tick;                        // Tick the snapshot was taken at
+} DiversityMetrics;
+
+// Runtime options parsed from the command line
+typedef struct
+{
+    int headless;              // Run without a window
+    long long maxTicks;        // Stop after this many ticks (0 = run until interrupted)
+    int metricsPort;           // Serve metrics on 127.0.0.1:port (0 = disabled)
+    const char *metricsSocket; // Serve metrics on a Unix domain socket (NULL = disabled)
+    int captureEvery;          // Capture a frame every N ticks (0 = disabled)
+    const char *captureDir;    // Directory for the PNG sequence
+    const char *capturePipe;   // Encoder command receiving raw RGBA frames (NULL = PNG sequence)
+    int threads;               // Threads for parallel phases (0 = one per CPU)
+    float frameBudgetMs;       // Interactive frame budget for the governor (0 = governor off)
+    int tilesX;                // World tiles across, one process each (headless)
+    int tilesY;                // World tiles down
+    int poolSize;              // Preallocated creature slots, also the population cap (0 = malloc per creature)
+    int hugePages;             // Back the creature pool with transparent huge pages
+    unsigned int seed;         // Random seed (default: the start time)
+} SimConfig;
+
+// Interactive tick budget governor: trades ticks per frame, grass spawning and births for frame time
+typedef struct
+{
+    int ticksPerFrame;          // Simulation ticks run per rendered frame
+    float grassSpawnScale;      // Multiplier on GRASS_SPAWN_CHANCE
+    int softCap;                // Population above which births and grass are withheld (0 = none)
+    double tickCost;            // Smoothed seconds per tick
+    double drawCost;            // Smoothed seconds spent drawing per frame
+    int framesSinceAdjustment;
+    long long adjustments;      // Governor changes so far
+    long long birthsSuppressed; // Births withheld by the soft cap
+    long long grassSuppressed;  // Grass spawns withheld by the spawn scale or soft cap
+} TickGovernor;
+
+// Population per species over a span of ticks
+typedef struct
+{
+    long long tick;            // Last tick covered
+    float min[SPECIES_COUNT];
+    float max[SPECIES_COUNT];
+    float mean[SPECIES_COUNT];
+} HistoryBucket;
+
+// Ring of buckets at one resolution, plus the bucket of the next level being filled
+typedef struct
+{
+    HistoryBucket buckets[HISTORY_LENGTH];
+    int head;                 // Next slot to write
+    int count;                // Buckets held (up to HISTORY_LENGTH)
+    long long pushed;         // Buckets ever written; more than HISTORY_LENGTH means the oldest were dropped
+    HistoryBucket pending;    // Aggregate of the buckets since the last fold
+    int pendingCount;
+    int span;                 // Coarsest level: incoming buckets folded into each stored one (doubles on compaction)
+} HistoryLevel;
+
+// Loop body run by ParallelFor over the index range [begin, end)
+typedef void (*ParallelBody)(int begin, int end, void *context);
+
+// Persistent worker threads sharing chunks of one loop at a time
+typedef struct
+{
+    pthread_t threads[MAX_WORKERS];
+    int workerCount;
+    pthread_mutex_t lock;
+    pthread_cond_t wake;         // Signalled when a new loop is posted or on shutdown
+    pthread_cond_t done;         // Signalled when the last worker finishes a loop
+    unsigned long generation;    // Incremented for every posted loop
+    int busy;                    // Workers still running the current loop
+    int stop;
+    ParallelBody body;
+    void *context;
+    int total;
+    int chunk;
+    _Atomic int next;            // Next unclaimed index
+} WorkerPool;
+
+// Nearest food, predator and mate found so far while scanning a creature's surroundings
+typedef struct
+{
+    float foodDist;
+    float predatorDist;
+    float mateDist;
+    Vector2 foodDir;
+    Vector2 predatorDir;
+    Vector2 mateDir;
+    unsigned int dietMask;     // Species the sensing creature eats
+    unsigned int predatorMask; // Species that eat the sensing creature
+} SenseResult;
+
+// Per-tick flat copy of the population used by the neighbour sweep and to resolve interactions
+typedef struct
+{
+    int count;
+    int capacity;
+    Creature **items;
+    unsigned long long *ids;
+    float *x;
+    float *y;
+    float *energy;           // Energy at the start of the tick, then after moving
+    unsigned char *type;
+    unsigned char *fertile;  // CanReproduce() at the start of the tick
+    float *output;           // Network outputs, OUTPUTS per creature
+    int *contacts;           // Prey and mates within reach, MAX_CONTACTS per creature
+    int *contactCount;       // Contacts found (above MAX_CONTACTS: the list overflowed)
+    _Atomic int *preyClaim;  // Index of the lowest-id eater reaching each creature, or -1
+    _Atomic int *mateClaim;  // Index of the lowest-id mate reaching each creature, or -1
+} InteractionScratch;
+
+// Position and color of one creature, copied for the headless heatmap
+typedef struct
+{
+    Vector2 position;
+    Color color;
+} CaptureDot;
+
+// A frame waiting in the capture queue: a rendered image or a creature snapshot to rasterise
+typedef struct
+{
+    long long tick;
+    Image image;      // Window capture (flipped render texture), or empty
+    CaptureDot *dots; // Headless snapshot, or NULL
+    int dotCount;
+} CaptureFrame;
+
+// Snapshot of simulation statistics, published once per tick for the metrics thread
+typedef struct
+{
+    long long tick;                       // Ticks simulated so far
+    int counts[SPECIES_COUNT];            // Living creatures per species
+    long long births[SPECIES_COUNT];      // Offspring born per species (total)
+    long long deaths[SPECIES_COUNT];      // Creatures removed per species (total)
+    float birthsPerSecond[SPECIES_COUNT]; // Birth rate over the last rate window
+    float deathsPerSecond[SPECIES_COUNT]; // Death rate over the last rate window
+    float energyMean[SPECIES_COUNT];      // Mean energy per species
+    float energyVariance[SPECIES_COUNT];  // Energy variance per species
+    float ageMean[SPECIES_COUNT];         // Mean age per species
+    float ageVariance[SPECIES_COUNT];     // Age variance per species
+    float speedMean[SPECIES_COUNT];       // Mean speed per species
+    float speedVariance[SPECIES_COUNT];   // Speed variance per species
+    DiversityMetrics diversity;           // Latest background diversity results
+    float ticksPerSecond;                 // Tick rate over the last rate window
+    double updateSeconds;                 // Time spent in UpdateCreatures() last tick
+    double thinkSeconds;                  // ... of which sensing and neural network
+    double interactSeconds;               // ... of which eating and reproduction
+    double drawSeconds;                   // Time spent drawing last frame
+    long long reorders;                   // Morton reorders of creature storage
+    float orderDrift;                     // Out-of-order fraction at the last drift check
+    int ticksPerFrame;                    // Governor: ticks per rendered frame
+    float grassSpawnScale;                // Governor: grass spawn rate multiplier
+    int softCap;                          // Governor: soft population cap (0 = none)
+    long long governorAdjustments;        // Governor changes so far
+    long long birthsSuppressed;           // Births withheld by the soft cap
+    long long grassSuppressed;            // Grass spawns withheld by the governor
+    long long framesCaptured;             // Frames written by the capture thread
+    long long framesDropped;              // Frames skipped because the capture queue was full
+    double readbackSeconds;               // GPU readback of the last captured window frame (blocks the main thread)
+    long long residentBytes;              // Resident set size of the process
+    long long peakResidentBytes;          // Highest resident set size so far
+    long long creatureBytes;              // Bytes held by creatures, genomes and list nodes
+    long long peakCreatureBytes;          // Highest creatureBytes so far
+    long long allocs[ALLOC_KIND_COUNT];   // Allocations per object kind (total)
+    long long frees[ALLOC_KIND_COUNT];    // Frees per object kind (total)
+    long long liveBytes[ALLOC_KIND_COUNT]; // Bytes allocated per object kind
+    int allocsLastTick;                   // Allocations during the last tick
+    int freesLastTick;                    // Frees during the last tick
+    int tiles;                            // Tile processes sharing the world (1 = unsharded)
+    int ghosts;                           // Creatures mirrored in from neighbouring tiles
+    long long migrations;                 // Creatures received from neighbouring tiles (total)
+    long long migrationsBlocked;          // Border crossings deferred because a migrant ring was full
+    int poolCapacity;                     // Creature slots in the preallocated pool (0 = no pool)
+    int poolUsed;                         // Creature slots in use
+    long long spawnsRefused;              // Creatures not created because the pool was full
+} SimStats;
+
+// Sides of a tile, indexing its neighbours and outgoing rings
+typedef enum
+{
+    TILE_LEFT,
+    TILE_RIGHT,
+    TILE_UP,
+    TILE_DOWN,
+    TILE_SIDES
+} TileSide;
+
+// A creature near a tile border, mirrored into the neighbouring tile for sensing only
+typedef struct
+{
+    Vector2 position;      // In the receiving tile's coordinates
+    unsigned char type;
+    unsigned char fertile; // CanReproduce() on the owning tile
+} GhostRecord;
+
+// Single-producer single-consumer ring of fixed-size records in shared memory
+typedef struct
+{
+    _Atomic unsigned int head; // Next record to read (consumer)
+    _Atomic unsigned int tail; // Next record to write (producer)
+    unsigned int capacity;
+    size_t recordSize;
+    unsigned char *records;    // Inside the shared mapping, at the same address in every process
+} ShardRing;
+
+// Per-tile part of the shared region; the rings are outboxes towards each neighbour
+typedef struct
+{
+    ShardRing ghosts[TILE_SIDES];
+    ShardRing migrants[TILE_SIDES]; // A Creature followed by its genome
+    SimStats stats;                 // Written by the tile before the second barrier of each tick
+    long long leakedAllocs[ALLOC_KIND_COUNT]; // Written by the tile once it has freed everything at exit
+    long long leakedBytes[ALLOC_KIND_COUNT];
+    _Atomic int leaksCounted;                 // Set after leakedAllocs and leakedBytes are written
+} TileShared;
+
+// Region mapped before the tile processes are forked
+typedef struct
+{
+    int tileCount;
+    int parties;                     // Tiles plus the coordinator
+    _Atomic unsigned int arrived;    // Barrier arrivals this round
+    _Atomic unsigned int generation; // Barrier rounds completed
+    _Atomic int stop;                // Set by the coordinator between the two barriers of a tick
+    _Atomic int abort;               // Set when a process died; releases everyone from the barrier
+    TileShared tiles[MAX_TILES];
+} ShardShared;
+
 // Add this function somewhere in the code
 float MutateValue(float value, float mutationRate)
 {
@@ -89,21 +490,35 @@ float MutateValue(float value, float mutationRate)
     return value;
 }
 
-// Check if a creature has enough energy to reproduce
-int CanReproduce(Creature *c)
+// Food web and species parameters, indexed by Species
+SpeciesInfo speciesTable[SPECIES_COUNT] = {
+    [RABBIT] = {"rabbit", "Rabbits", SPECIES_BIT(GRASS), 0, RABBIT_STARTENERGY, RABBIT_SPEED, 2.5f, RABBIT_REPRODUCTIONAGE, 0.02f, GREEN, "./assets/rabbit.png"},
+    [DUCK] = {"duck", "Ducks", SPECIES_BIT(GRASS), 0, DUCK_STARTENERGY, DUCK_SPEED, 1.5f, DUCK_REPRODUCTIONAGE, 0.03f, BLUE, "./assets/duck.png"},
+    [FOX] = {"fox", "Foxes", SPECIES_BIT(RABBIT) | SPECIES_BIT(DUCK), 0, FOX_STARTENERGY, FOX_SPEED, 1.2f, FOX_REPRODUCTIONAGE, 0.06f, ORANGE, "./assets/fox.png"},
+    [WOLF] = {"wolf", "Wolves", SPECIES_BIT(RABBIT) | SPECIES_BIT(DUCK) | SPECIES_BIT(FOX), 0, WOLF_STARTENERGY, WOLF_SPEED, 1.0f, WOLF_REPRODUCTIONAGE, 0.09f, RED, "./assets/wolf.png"},
+    [GRASS] = {"grass", "Grass", 0, 0, GRASS_ENERGY, 0, 0, 0, 0, DARKGREEN, "./assets/grass.png"},
+};
+
+// Derive each species' predators from the diets
+void SetupFoodWeb()
 {
-    switch (c->type)
+    for (int prey = 0; prey < SPECIES_COUNT; prey++)
     {
-    case RABBIT:
-        return c->energy > RABBIT_STARTENERGY * .5f && c->age > RABBIT_REPRODUCTIONAGE && c->last_mate > RABBIT_REPRODUCTIONAGE;
-    case DUCK:
-        return c->energy > DUCK_STARTENERGY * .5f && c->age > DUCK_REPRODUCTIONAGE && c->last_mate > DUCK_REPRODUCTIONAGE;
-    case FOX:
-        return c->energy > FOX_STARTENERGY * .5f && c->age > FOX_REPRODUCTIONAGE && c->last_mate > FOX_REPRODUCTIONAGE;
-    case WOLF:
-        return c->energy > WOLF_STARTENERGY * .5f && c->age > WOLF_REPRODUCTIONAGE && c->last_mate > WOLF_REPRODUCTIONAGE;
+        speciesTable[prey].predatorMask = 0;
+        for (int eater = 0; eater < SPECIES_COUNT; eater++)
+        {
+            if (speciesTable[eater].dietMask & SPECIES_BIT(prey))
+                speciesTable[prey].predatorMask |= SPECIES_BIT(eater);
+        }
     }
-    return 0;
+}
+
+// Check if a creature has enough energy to reproduce
+int CanReproduce(const Creature *c)
+{
+    const SpeciesInfo *species = &speciesTable[c->type];
+    return species->reproductionAge > 0 && c->energy > species->startEnergy * .5f &&
+           c->age > species->reproductionAge && c->last_mate > species->reproductionAge;
 }
 
 // Enhanced activation function using fast sigmoid approximation
@@ -117,56 +532,270 @@ float Activate(float x)
     float abs_x = fabsf(x);
     return 0.5f * (x / (1.0f + abs_x) + 1.0f);
 }
-void InitializeNetwork(NeuralNetwork *nn)
+
+// Allocation counters for simulation objects
+AllocStats allocStats = {0};
+const char *allocKindNames[ALLOC_KIND_COUNT] = {"creature", "grass", "genome", "node"};
+
+// Preallocated pools for creature structs (grass included), genomes and list nodes (see StartCreaturePool)
+ObjectPool creaturePool = {0};
+ObjectPool genomePool = {0};
+ObjectPool nodePool = {0};
+void *poolMapping = NULL;
+size_t poolMappingBytes = 0;
+long long spawnsRefused = 0;
+
+// Take a free slot from a pool, or NULL if it is full
+void *PoolAlloc(ObjectPool *pool)
+{
+    if (pool->freeCount == 0)
+        return NULL;
+    return pool->base + (size_t)pool->freeSlots[--pool->freeCount] * pool->slotSize;
+}
+
+// Return a slot to its pool
+void PoolFree(ObjectPool *pool, void *ptr)
+{
+    pool->freeSlots[pool->freeCount++] = (int)(((unsigned char *)ptr - pool->base) / pool->slotSize);
+}
+
+// Pool serving an allocation kind, or NULL when creatures come from malloc()
+ObjectPool *PoolForKind(AllocKind kind)
+{
+    if (poolMapping == NULL)
+        return NULL;
+    if (kind == ALLOC_GENOME)
+        return &genomePool;
+    if (kind == ALLOC_NODE)
+        return &nodePool;
+    return &creaturePool;
+}
+
+// Carve a pool of capacity slots out of the mapping at *cursor
+void SetupPool(ObjectPool *pool, unsigned char **cursor, size_t slotSize, int capacity)
+{
+    pool->base = *cursor;
+    pool->slotSize = slotSize;
+    pool->capacity = capacity;
+    pool->freeSlots = (int *)malloc(capacity * sizeof(int));
+    for (int i = 0; i < capacity; i++)
+        pool->freeSlots[i] = capacity - 1 - i; // Hand out low addresses first
+    pool->freeCount = capacity;
+    *cursor += (size_t)capacity * slotSize;
+}
+
+// malloc() with per-kind accounting, served from the creature pool when there is one
+void *TrackedAlloc(AllocKind kind, size_t size)
+{
+    ObjectPool *pool = PoolForKind(kind);
+    void *ptr = pool != NULL ? PoolAlloc(pool) : malloc(size);
+    if (ptr == NULL)
+        return NULL;
+    allocStats.allocs[kind]++;
+    allocStats.liveBytes[kind] += size;
+    long long live = 0;
+    for (int i = 0; i < ALLOC_KIND_COUNT; i++)
+        live += allocStats.liveBytes[i];
+    if (live > allocStats.peakLiveBytes)
+        allocStats.peakLiveBytes = live;
+    return ptr;
+}
+
+// free() for memory from TrackedAlloc(); size must match the allocation
+void TrackedFree(AllocKind kind, void *ptr, size_t size)
+{
+    if (ptr == NULL)
+        return;
+    allocStats.frees[kind]++;
+    allocStats.liveBytes[kind] -= size;
+    ObjectPool *pool = PoolForKind(kind);
+    if (pool != NULL)
+        PoolFree(pool, ptr);
+    else
+        free(ptr);
+}
+
+// Allocation kind of a Creature struct of the given species
+AllocKind CreatureAllocKind(Species type)
+{
+    return type == GRASS ? ALLOC_GRASS : ALLOC_CREATURE;
+}
+
+// Allocate a Creature struct; NULL (counted as a refused spawn) when the creature pool is full
+Creature *AllocCreature(AllocKind kind)
 {
-    // Initialize input->hidden weights and biases
-    for (int i = 0; i < HIDDEN; i++)
+    Creature *c = (Creature *)TrackedAlloc(kind, sizeof(Creature));
+    if (c == NULL)
+        spawnsRefused++;
+    return c;
+}
+
+// Active network topology (see SetupTopology)
+NetworkTopology topology = {0};
+
+// Dense layer kernel with sizes fixed at compile time so the loops unroll and vectorise
+#define DEFINE_DENSE_KERNEL(IN, OUT)                                                                  \
+    void Dense_##IN##x##OUT(const float *layer, const float *in, float *out, int inSize, int outSize) \
+    {                                                                                                 \
+        const float *bias = layer + (IN) * (OUT);                                                     \
+        for (int o = 0; o < (OUT); o++)                                                               \
+        {                                                                                             \
+            const float *w = layer + o * (IN);                                                        \
+            float sum = bias[o];                                                                      \
+            for (int i = 0; i < (IN); i++)                                                            \
+            {                                                                                         \
+                sum += w[i] * in[i];                                                                  \
+            }                                                                                         \
+            out[o] = Activate(sum);                                                                   \
+        }                                                                                             \
+    }
+
+// Common layer shapes: the default 17->10->2 and power-of-two widths
+DEFINE_DENSE_KERNEL(17, 10)
+DEFINE_DENSE_KERNEL(10, 10)
+DEFINE_DENSE_KERNEL(10, 2)
+DEFINE_DENSE_KERNEL(17, 8)
+DEFINE_DENSE_KERNEL(8, 8)
+DEFINE_DENSE_KERNEL(8, 2)
+DEFINE_DENSE_KERNEL(17, 16)
+DEFINE_DENSE_KERNEL(16, 16)
+DEFINE_DENSE_KERNEL(16, 2)
+DEFINE_DENSE_KERNEL(17, 32)
+DEFINE_DENSE_KERNEL(32, 32)
+DEFINE_DENSE_KERNEL(32, 2)
+
+// Generic fallback for any other layer shape
+void DenseGeneric(const float *layer, const float *in, float *out, int inSize, int outSize)
+{
+    const float *bias = layer + inSize * outSize;
+    for (int o = 0; o < outSize; o++)
     {
-        for (int j = 0; j < INPUTS; j++)
+        const float *w = layer + o * inSize;
+        float sum = bias[o];
+        for (int i = 0; i < inSize; i++)
         {
-            // Generate random number between -1 and 1 with more variance
-            float rand_val = 2.0f * ((float)rand() / RAND_MAX) - 1.0f;
-            nn->weightsIH[i][j] = rand_val;
+            sum += w[i] * in[i];
         }
-        // Initialize biases with larger range
-        nn->biasH[i] = (((float)rand() / RAND_MAX) * 2.0f - 1.0f);
+        out[o] = Activate(sum);
+    }
+}
+
+// Pick the specialised kernel for a layer shape, or the generic one
+LayerKernel SelectKernel(int inSize, int outSize)
+{
+    static const struct
+    {
+        int inSize, outSize;
+        LayerKernel kernel;
+    } specialised[] = {
+        {17, 10, Dense_17x10}, {10, 10, Dense_10x10}, {10, 2, Dense_10x2},
+        {17, 8, Dense_17x8}, {8, 8, Dense_8x8}, {8, 2, Dense_8x2},
+        {17, 16, Dense_17x16}, {16, 16, Dense_16x16}, {16, 2, Dense_16x2},
+        {17, 32, Dense_17x32}, {32, 32, Dense_32x32}, {32, 2, Dense_32x2},
+    };
+    for (size_t i = 0; i < sizeof(specialised) / sizeof(specialised[0]); i++)
+    {
+        if (specialised[i].inSize == inSize && specialised[i].outSize == outSize)
+            return specialised[i].kernel;
+    }
+    return DenseGeneric;
+}
+
+// Build the global topology from the hidden layer widths; returns 0 if the shape is unsupported
+int SetupTopology(const int *hidden, int hiddenCount)
+{
+    if (hiddenCount < 0 || hiddenCount > MAX_LAYERS - 2)
+        return 0;
+    topology.layerCount = hiddenCount + 2;
+    topology.sizes[0] = INPUTS;
+    for (int i = 0; i < hiddenCount; i++)
+    {
+        if (hidden[i] < 1 || hidden[i] > MAX_LAYER_WIDTH)
+            return 0;
+        topology.sizes[i + 1] = hidden[i];
+    }
+    topology.sizes[hiddenCount + 1] = OUTPUTS;
+
+    topology.genomeLength = 0;
+    topology.kernels[0] = NULL;
+    for (int i = 1; i < topology.layerCount; i++)
+    {
+        topology.kernels[i] = SelectKernel(topology.sizes[i - 1], topology.sizes[i]);
+        topology.genomeLength += topology.sizes[i] * (topology.sizes[i - 1] + 1);
     }
+    return 1;
+}
+
+// Allocate an (uninitialised) genome for the active topology
+void AllocateNetwork(NeuralNetwork *nn)
+{
+    nn->genes = (float *)TrackedAlloc(ALLOC_GENOME, topology.genomeLength * sizeof(float));
+}
+
+// Run a brain forward: inputs[INPUTS] -> output[OUTPUTS]
+void RunNetwork(const NeuralNetwork *nn, const float *inputs, float output[OUTPUTS])
+{
+    float bufferA[MAX_LAYER_WIDTH];
+    float bufferB[MAX_LAYER_WIDTH];
+    const float *layer = nn->genes;
+    const float *in = inputs;
+    float *out = bufferA;
 
-    // Initialize hidden->output weights and biases
+    for (int i = 1; i < topology.layerCount; i++)
+    {
+        int inSize = topology.sizes[i - 1];
+        int outSize = topology.sizes[i];
+        topology.kernels[i](layer, in, out, inSize, outSize);
+        layer += outSize * (inSize + 1);
+        in = out;
+        out = (out == bufferA) ? bufferB : bufferA;
+    }
     for (int i = 0; i < OUTPUTS; i++)
     {
-        for (int j = 0; j < HIDDEN; j++)
-        {
-            float rand_val = 2.0f * ((float)rand() / RAND_MAX) - 1.0f;
-            nn->weightsHO[i][j] = rand_val;
-        }
-        // Initialize output biases with larger range
-        nn->biasO[i] = (((float)rand() / RAND_MAX) * 2.0f - 1.0f);
+        output[i] = in[i];
+    }
+}
+
+void InitializeNetwork(NeuralNetwork *nn)
+{
+    // Initialize all weights and biases
+    for (int i = 0; i < topology.genomeLength; i++)
+    {
+        // Generate random number between -1 and 1 with more variance
+        float rand_val = 2.0f * ((float)rand() / RAND_MAX) - 1.0f;
+        nn->genes[i] = rand_val;
     }
 
     // Validate all values
-    for (int i = 0; i < HIDDEN; i++)
+    for (int i = 0; i < topology.genomeLength; i++)
     {
-        for (int j = 0; j < INPUTS; j++)
-        {
-            if (isnan(nn->weightsIH[i][j]))
-                nn->weightsIH[i][j] = 0.0f;
-        }
-        if (isnan(nn->biasH[i]))
-            nn->biasH[i] = 0.0f;
+        if (isnan(nn->genes[i]))
+            nn->genes[i] = 0.0f;
     }
+}
 
-    for (int i = 0; i < OUTPUTS; i++)
+// Squared Euclidean distance between two genomes
+// Eight independent partial sums let the compiler vectorise without reassociating the float adds
+float GenomeDistanceSq(const float *restrict a, const float *restrict b, int length)
+{
+    float lane[8] = {0};
+    int k = 0;
+    for (; k + 8 <= length; k += 8)
     {
-        for (int j = 0; j < HIDDEN; j++)
+        for (int j = 0; j < 8; j++)
         {
-            if (isnan(nn->weightsHO[i][j]))
-                nn->weightsHO[i][j] = 0.0f;
+            float diff = a[k + j] - b[k + j];
+            lane[j] += diff * diff;
         }
-        if (isnan(nn->biasO[i]))
-            nn->biasO[i] = 0.0f;
     }
+    for (; k < length; k++)
+    {
+        float diff = a[k] - b[k];
+        lane[0] += diff * diff;
+    }
+    return ((lane[0] + lane[1]) + (lane[2] + lane[3])) + ((lane[4] + lane[5]) + (lane[6] + lane[7]));
 }
+
 // Define the linked list node structure for dynamic creature management
 typedef struct CreatureNode
 {
@@ -180,18 +809,276 @@ CreatureNode *creatureList = NULL;
 // Global array of hearth effects
 HearthEffect hearthEffects[MAX_HEARTH_EFFECTS] = {0};
 
-Texture2D RabbitIcon;
-Texture2D DuckIcon;
-Texture2D FoxIcon;
-Texture2D WolfIcon;
-Texture2D GrassIcon;
+// Species icons, loaded from speciesTable[].iconPath
+Texture2D speciesIcons[SPECIES_COUNT];
+
+// Runtime options
+SimConfig config = {0};
+
+// Next creature id handed out by AddCreature()
+unsigned long long nextCreatureId = 1;
+
+// Simulation counters feeding the published statistics
+long long simTick = 0;
+long long birthTotals[SPECIES_COUNT] = {0};
+long long deathTotals[SPECIES_COUNT] = {0};
+double thinkSeconds = 0;    // Measured per tick by UpdateCreatures()
+double interactSeconds = 0; // Measured per tick by UpdateCreatures()
+
+// Worker threads for parallel phases
+WorkerPool pool = {.lock = PTHREAD_MUTEX_INITIALIZER, .wake = PTHREAD_COND_INITIALIZER, .done = PTHREAD_COND_INITIALIZER};
+
+// Scratch arrays for ResolveInteractions()
+InteractionScratch scratch = {0};
+
+// Governor state (ticksPerFrame and the throttles stay neutral in headless runs)
+TickGovernor governor = {.ticksPerFrame = 1, .grassSpawnScale = 1.0f};
+
+// Morton reordering state
+Creature **creatureHandles[MAX_CREATURE_HANDLES] = {0}; // Pointers fixed up after a reorder
+int creatureHandleCount = 0;
+long long reorderCount = 0; // Reorders performed
+float orderDrift = 0;       // Fraction of list neighbours out of Z-order at the last check
+
+// Running population sums (simulation thread only)
+PopulationStats population = {0};
+
+// Brain snapshot handed to the diversity thread; owned by that thread while diversityPending is set
+float *diversityGenes[SPECIES_COUNT] = {0}; // DIVERSITY_SAMPLE genomes per species
+int diversityCounts[SPECIES_COUNT] = {0};
+int diversityPopulation[SPECIES_COUNT] = {0}; // Living creatures when the sample was taken
+int diversityPending = 0;
+int diversityStop = 0;
+int diversityStarted = 0;
+long long diversityTick = 0;
+pthread_mutex_t diversityLock = PTHREAD_MUTEX_INITIALIZER;
+pthread_cond_t diversityWake = PTHREAD_COND_INITIALIZER;
+pthread_t diversityThread;
+
+// Latest diversity results, written by the diversity thread
+DiversityMetrics diversityResults = {0};
+float *strategyMedoids[SPECIES_COUNT] = {0}; // MAX_STRATEGIES medoid genomes per species
+unsigned int strategyEpoch = 0;              // Incremented for every published clustering
+pthread_mutex_t diversityResultsLock = PTHREAD_MUTEX_INITIALIZER;
+
+// Medoids used to tint creatures by strategy (drawing thread only)
+float *drawMedoids[SPECIES_COUNT] = {0};
+int drawStrategies[SPECIES_COUNT] = {0};
+unsigned int drawEpoch = 0;
+int strategyTint = 0;
+
+// Published statistics, guarded by a sequence lock so readers never block the tick loop
+_Atomic unsigned int statsSequence = 0;
+SimStats publishedStats = {0};
+
+// Capture queue, drained by the capture thread
+CaptureFrame captureQueue[CAPTURE_QUEUE_SIZE];
+int captureHead = 0;
+int captureLength = 0;
+int captureStop = 0;
+int captureStarted = 0;
+pthread_mutex_t captureLock = PTHREAD_MUTEX_INITIALIZER;
+pthread_cond_t captureWake = PTHREAD_COND_INITIALIZER;
+pthread_t captureThread;
+FILE *captureEncoder = NULL;
+_Atomic long long framesCaptured = 0;
+long long framesDropped = 0;
+RenderTexture2D captureTarget;
+double readbackSeconds = 0;      // Last window frame readback
+double readbackTotalSeconds = 0; // All window frame readbacks
+long long readbackCount = 0;
+
+// Metrics server state
+_Atomic int metricsRunning = 0;
+int metricsListenFd = -1;
+pthread_t metricsThread;
+
+// Sharded world state (shard is NULL when the world is a single process)
+ShardShared *shard = NULL;
+size_t shardBytes = 0;
+pid_t coordinatorPid = 0;
+int tileIndex = 0;
+int tileNeighbours[TILE_SIDES] = {-1, -1, -1, -1};
+Vector2 worldOrigin = {0, 0};                     // Tile offset within the world
+Vector2 worldSize = {WINDOW_WIDTH, WINDOW_HEIGHT}; // Whole world, across all tiles
+GhostRecord *ghosts = NULL;                        // Mirrored border creatures of the neighbours
+int ghostCount = 0;
+long long migrationsIn = 0;
+long long migrationsBlocked = 0;
+unsigned int refusedMigrant[TILE_SIDES] = {0}; // Ring position + 1 of the waiting migrant already counted as refused
+
+// Multi-resolution population history for the in-window graph
+HistoryLevel history[HISTORY_LEVELS] = {0};
+
+// Headless run flag, cleared by SIGINT/SIGTERM
+volatile sig_atomic_t keepRunning = 1;
+
+// Monotonic wall clock in seconds (usable without a window)
+double NowSeconds()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// NaN-safe contribution of a value to the running sums
+double StatValue(float value)
+{
+    return isnan(value) ? 0.0 : value;
+}
+
+// Add (sign = 1) or remove (sign = -1) a creature from the running population sums
+void TrackCreature(const Creature *c, int sign)
+{
+    if (c->type >= SPECIES_COUNT)
+        return;
+    double energy = StatValue(c->energy);
+    double age = c->age;
+    double speed = StatValue(c->speed);
+    population.count[c->type] += sign;
+    population.energySum[c->type] += sign * energy;
+    population.energySumSq[c->type] += sign * energy * energy;
+    population.ageSum[c->type] += sign * age;
+    population.ageSumSq[c->type] += sign * age * age;
+    population.speedSum[c->type] += sign * speed;
+    population.speedSumSq[c->type] += sign * speed * speed;
+}
+
+// Total creatures alive, from the running counts
+int LivingCreatures()
+{
+    int count = 0;
+    for (int i = 0; i < SPECIES_COUNT; i++)
+        count += population.count[i];
+    return count;
+}
+
+// Change a creature's energy, keeping the running sums up to date
+void SetCreatureEnergy(Creature *c, float energy)
+{
+    double before = StatValue(c->energy);
+    double after = StatValue(energy);
+    population.energySum[c->type] += after - before;
+    population.energySumSq[c->type] += after * after - before * before;
+    c->energy = energy;
+}
+
+// Advance a creature's age by one tick, keeping the running sums up to date
+void AgeCreature(Creature *c)
+{
+    population.ageSum[c->type] += 1;
+    population.ageSumSq[c->type] += 2.0 * c->age + 1;
+    c->age++;
+}
+
+// Run chunks of the posted loop until none are left
+void RunPoolChunks()
+{
+    for (;;)
+    {
+        int begin = atomic_fetch_add(&pool.next, pool.chunk);
+        if (begin >= pool.total)
+            break;
+        int end = begin + pool.chunk < pool.total ? begin + pool.chunk : pool.total;
+        pool.body(begin, end, pool.context);
+    }
+}
+
+// Worker thread: wait for a loop, help run it, report completion
+void *WorkerThreadMain(void *arg)
+{
+    unsigned long seen = 0;
+    for (;;)
+    {
+        pthread_mutex_lock(&pool.lock);
+        while (pool.generation == seen && !pool.stop)
+            pthread_cond_wait(&pool.wake, &pool.lock);
+        if (pool.stop)
+        {
+            pthread_mutex_unlock(&pool.lock);
+            break;
+        }
+        seen = pool.generation;
+        pthread_mutex_unlock(&pool.lock);
+
+        RunPoolChunks();
+
+        pthread_mutex_lock(&pool.lock);
+        if (--pool.busy == 0)
+            pthread_cond_signal(&pool.done);
+        pthread_mutex_unlock(&pool.lock);
+    }
+    return NULL;
+}
+
+// Run body over [0, count) on the pool and the calling thread; returns when every index is done
+// Chunks hold at least grain indices; loops of grain indices or fewer run on the calling thread
+void ParallelFor(int count, int grain, ParallelBody body, void *context)
+{
+    if (pool.workerCount == 0 || count <= grain)
+    {
+        body(0, count, context);
+        return;
+    }
+    int threads = pool.workerCount + 1;
+    pthread_mutex_lock(&pool.lock);
+    pool.body = body;
+    pool.context = context;
+    pool.total = count;
+    pool.chunk = count / (threads * 8) > grain ? count / (threads * 8) : grain;
+    atomic_store(&pool.next, 0);
+    pool.busy = pool.workerCount;
+    pool.generation++;
+    pthread_cond_broadcast(&pool.wake);
+    pthread_mutex_unlock(&pool.lock);
+
+    RunPoolChunks();
+
+    pthread_mutex_lock(&pool.lock);
+    while (pool.busy > 0)
+        pthread_cond_wait(&pool.done, &pool.lock);
+    pthread_mutex_unlock(&pool.lock);
+}
+
+// Start the worker threads (config.threads includes the calling thread)
+void StartWorkerPool()
+{
+    int threads = config.threads > 0 ? config.threads : (int)sysconf(_SC_NPROCESSORS_ONLN);
+    if (threads < 1)
+        threads = 1;
+    if (threads > MAX_WORKERS + 1)
+        threads = MAX_WORKERS + 1;
+    pool.stop = 0;
+    pool.workerCount = 0;
+    for (int i = 0; i < threads - 1; i++)
+    {
+        if (pthread_create(&pool.threads[i], NULL, WorkerThreadMain, NULL) != 0)
+            break;
+        pool.workerCount++;
+    }
+}
+
+// Stop and join the worker threads
+void StopWorkerPool()
+{
+    pthread_mutex_lock(&pool.lock);
+    pool.stop = 1;
+    pthread_cond_broadcast(&pool.wake);
+    pthread_mutex_unlock(&pool.lock);
+    for (int i = 0; i < pool.workerCount; i++)
+        pthread_join(pool.threads[i], NULL);
+    pool.workerCount = 0;
+}
 
 // Add a creature to the linked list
 void AddCreature(Creature *creature)
 {
-    CreatureNode *newNode = (CreatureNode *)malloc(sizeof(CreatureNode));
+    CreatureNode *newNode = (CreatureNode *)TrackedAlloc(ALLOC_NODE, sizeof(CreatureNode));
     newNode->data = creature;
     newNode->next = NULL;
+    creature->id = nextCreatureId++;
+    creature->strategyEpoch = 0;
+    TrackCreature(creature, 1);
 
     // If list is empty, make the new node the head
     if (creatureList == NULL)
@@ -211,32 +1098,112 @@ void AddCreature(Creature *creature)
     }
 }
 
-// Initialize the starting population of creatures
-void InitializeCreatures()
+// Free a list node together with its creature data and genome
+void FreeCreatureNode(CreatureNode *node)
+{
+    Creature *creature = node->data;
+    if (creature->brain.genes != NULL)
+        TrackedFree(ALLOC_GENOME, creature->brain.genes, topology.genomeLength * sizeof(float)); // Free genome
+    TrackedFree(CreatureAllocKind(creature->type), creature, sizeof(Creature));               // Free creature data
+    TrackedFree(ALLOC_NODE, node, sizeof(CreatureNode));                                       // Free node itself
+}
+
+// Account for a removed creature and free it
+void ReleaseCreatureNode(CreatureNode *node)
+{
+    Creature *creature = node->data;
+    if (creature->type < SPECIES_COUNT)
+        deathTotals[creature->type]++;
+    TrackCreature(creature, -1);
+    FreeCreatureNode(node);
+}
+
+// Free every creature without counting them as deaths (reset and shutdown)
+void FreeAllCreatures()
 {
-    // Clear existing list if any
     while (creatureList != NULL)
     {
         CreatureNode *temp = creatureList;
         creatureList = creatureList->next;
-        free(temp);
+        FreeCreatureNode(temp);
     }
+    population = (PopulationStats){0};
+}
 
-    // Create POP_SIZE creatures with varied properties
-    for (int i = 0; i < POP_SIZE; i++)
+// Map and pre-fault one slot per creature, genome and node for config.poolSize creatures; returns 0 on failure.
+// Genomes and nodes never outnumber creatures, so only creature allocations can find their pool full.
+int StartCreaturePool()
+{
+    if (config.poolSize == 0)
+        return 1;
+    size_t creatureSlot = (sizeof(Creature) + 15) & ~(size_t)15;
+    size_t genomeSlot = (topology.genomeLength * sizeof(float) + POOL_SLOT_ALIGN - 1) & ~(size_t)(POOL_SLOT_ALIGN - 1);
+    size_t nodeSlot = (sizeof(CreatureNode) + 15) & ~(size_t)15;
+    size_t bytes = (size_t)config.poolSize * (genomeSlot + creatureSlot + nodeSlot);
+    if (config.hugePages)
+        bytes = (bytes + HUGE_PAGE_SIZE - 1) & ~(size_t)(HUGE_PAGE_SIZE - 1);
+
+    void *mapping = mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (mapping == MAP_FAILED)
     {
-        Creature *newCreature;
-        newCreature = (Creature *)malloc(sizeof(Creature));
-        newCreature->age = 0;
-        newCreature->last_mate = 0;
-        // Random starting position
-        newCreature->position = (Vector2){
-            50 + rand() % (WINDOW_WIDTH - 100),
-            50 + rand() % (WINDOW_HEIGHT - 100)};
-        // Determine creature type by probability
-        float r = (float)rand() / RAND_MAX;
-        if (r < 0.5f)
-            newCreature->type = RABBIT; // 40% chance
+        perror("mmap creature pool");
+        return 0;
+    }
+    if (config.hugePages)
+    {
+#ifdef MADV_HUGEPAGE
+        if (madvise(mapping, bytes, MADV_HUGEPAGE) != 0)
+            perror("madvise(MADV_HUGEPAGE), using normal pages");
+#else
+        fprintf(stderr, "Transparent huge pages are not supported here, using normal pages\n");
+#endif
+    }
+    memset(mapping, 0, bytes); // Fault every page in now rather than mid-run
+
+    // Genomes first so their slots stay cache-line aligned
+    unsigned char *cursor = (unsigned char *)mapping;
+    SetupPool(&genomePool, &cursor, genomeSlot, config.poolSize);
+    SetupPool(&creaturePool, &cursor, creatureSlot, config.poolSize);
+    SetupPool(&nodePool, &cursor, nodeSlot, config.poolSize);
+    poolMapping = mapping;
+    poolMappingBytes = bytes;
+    return 1;
+}
+
+// Unmap the creature pool once every creature has been freed
+void StopCreaturePool()
+{
+    if (poolMapping == NULL)
+        return;
+    free(genomePool.freeSlots);
+    free(creaturePool.freeSlots);
+    free(nodePool.freeSlots);
+    munmap(poolMapping, poolMappingBytes);
+    poolMapping = NULL;
+}
+
+// Initialize the starting population of creatures
+void InitializeCreatures()
+{
+    // Clear existing list if any
+    FreeAllCreatures();
+
+    // Create POP_SIZE creatures with varied properties
+    for (int i = 0; i < POP_SIZE; i++)
+    {
+        Creature *newCreature = AllocCreature(ALLOC_CREATURE);
+        if (newCreature == NULL)
+            break; // Pool smaller than the starting population
+        newCreature->age = 0;
+        newCreature->last_mate = 0;
+        // Random starting position
+        newCreature->position = (Vector2){
+            50 + rand() % (WINDOW_WIDTH - 100),
+            50 + rand() % (WINDOW_HEIGHT - 100)};
+        // Determine creature type by probability
+        float r = (float)rand() / RAND_MAX;
+        if (r < 0.5f)
+            newCreature->type = RABBIT; // 40% chance
         // else if (r < 0.995f)
         //     newCreature->type = DUCK; // 30% chance
         // else if (r < 0.998f)
@@ -244,539 +1211,2906 @@ void InitializeCreatures()
         else
             newCreature->type = RABBIT; // 15% chance
 
-        // Set starting energy based on species type
-        switch (newCreature->type)
+        // Set starting energy and speed based on species type
+        const SpeciesInfo *species = &speciesTable[newCreature->type];
+        newCreature->energy = species->startEnergy;
+        newCreature->speed = species->speed + ((float)rand() / RAND_MAX) * 0.5f;
+
+        // Initialize the neural network "brain"
+        AllocateNetwork(&newCreature->brain);
+        InitializeNetwork(&newCreature->brain);
+
+        // Set color based on species type for visual identification
+        newCreature->color = species->color;
+        AddCreature(newCreature);
+    }
+}
+
+// Unlink and free every creature that has run out of energy or become invalid, in one pass
+void RemoveDeadCreatures()
+{
+    CreatureNode **link = &creatureList;
+    while (*link != NULL)
+    {
+        CreatureNode *node = *link;
+        Creature *c = node->data;
+        if (c->energy <= 0 || isnan(c->energy) || isnan(c->position.x) || isnan(c->position.y))
         {
-        case RABBIT:
-            newCreature->energy = RABBIT_STARTENERGY;
-            newCreature->speed = RABBIT_SPEED + ((float)rand() / RAND_MAX) * 0.5f;
-            break;
-        case DUCK:
-            newCreature->energy = DUCK_STARTENERGY;
-            newCreature->speed = DUCK_SPEED + ((float)rand() / RAND_MAX) * 0.5f;
-            break;
-        case FOX:
-            newCreature->energy = FOX_STARTENERGY;
-            newCreature->speed = FOX_SPEED + ((float)rand() / RAND_MAX) * 0.5f;
-            break;
-        case WOLF:
-            newCreature->energy = WOLF_STARTENERGY;
-            newCreature->speed = WOLF_SPEED + ((float)rand() / RAND_MAX) * 0.5f;
+            *link = node->next;
+            ReleaseCreatureNode(node);
+        }
+        else
+        {
+            link = &node->next;
+        }
+    }
+}
+
+// Create an offspring of two parents and add it to the simulation
+void CreateOffspring(Creature *current, Creature *partner)
+{
+    // Create offspring with traits from both parents
+    Creature *offspring = AllocCreature(ALLOC_CREATURE);
+    if (offspring == NULL)
+        return; // Population cap reached; the parents keep their energy
+    offspring->type = current->type;
+    offspring->speed = current->speed;
+    offspring->color = current->color;
+
+    // Mix neural networks from both parents
+    AllocateNetwork(&offspring->brain);
+    for (int i = 0; i < topology.genomeLength; i++)
+    {
+        // 50% chance to inherit from each parent
+        offspring->brain.genes[i] = MutateValue(
+            (rand() % 2) ? current->brain.genes[i] : partner->brain.genes[i],
+            MUTATION_CHANCE);
+    }
+
+    // Position offspring near parents with slight randomness
+    offspring->position = (Vector2){
+        current->position.x + ((float)rand() / RAND_MAX * 40 - 20),
+        current->position.y + ((float)rand() / RAND_MAX * 40 - 20)};
+
+    // Transfer energy from parents to offspring
+    float parentEnergy1 = current->energy / 3;
+    float parentEnergy2 = partner->energy / 3;
+
+    if (isnan(parentEnergy1) || isnan(parentEnergy2))
+    {
+        parentEnergy1 = fmaxf(0, current->energy / 3);
+        parentEnergy2 = fmaxf(0, partner->energy / 3);
+    }
+
+    offspring->energy = parentEnergy1 + parentEnergy2;
+    SetCreatureEnergy(current, current->energy * 2 / 3);
+    SetCreatureEnergy(partner, partner->energy * 2 / 3);
+    offspring->age = 0;
+    offspring->last_mate = 0;
+    // Add offspring to the simulation
+    AddCreature(offspring);
+    birthTotals[offspring->type]++;
+    // Add hearth effect
+    for (size_t i = 0; i < MAX_HEARTH_EFFECTS; i++)
+    {
+        if (hearthEffects[i].age == 0 && hearthEffects[i].position.x == 0 && hearthEffects[i].position.y == 0)
+        {
+            hearthEffects[i].age = 1;
+            hearthEffects[i].position = offspring->position;
             break;
         }
+    }
+}
+
+// Whether the governor's soft population cap allows another creature
+int BelowSoftCap()
+{
+    return governor.softCap == 0 || LivingCreatures() < governor.softCap;
+}
+
+// Grow the scratch arrays to hold at least count creatures
+void ReserveInteractionScratch(int count)
+{
+    if (count <= scratch.capacity)
+        return;
+    int capacity = scratch.capacity > 0 ? scratch.capacity : 1024;
+    while (capacity < count)
+        capacity *= 2;
+    scratch.items = (Creature **)realloc(scratch.items, capacity * sizeof(Creature *));
+    scratch.ids = (unsigned long long *)realloc(scratch.ids, capacity * sizeof(unsigned long long));
+    scratch.x = (float *)realloc(scratch.x, capacity * sizeof(float));
+    scratch.y = (float *)realloc(scratch.y, capacity * sizeof(float));
+    scratch.energy = (float *)realloc(scratch.energy, capacity * sizeof(float));
+    scratch.type = (unsigned char *)realloc(scratch.type, capacity);
+    scratch.fertile = (unsigned char *)realloc(scratch.fertile, capacity);
+    scratch.output = (float *)realloc(scratch.output, (size_t)capacity * OUTPUTS * sizeof(float));
+    scratch.contacts = (int *)realloc(scratch.contacts, (size_t)capacity * MAX_CONTACTS * sizeof(int));
+    scratch.contactCount = (int *)realloc(scratch.contactCount, capacity * sizeof(int));
+    scratch.preyClaim = (_Atomic int *)realloc((void *)scratch.preyClaim, capacity * sizeof(_Atomic int));
+    scratch.mateClaim = (_Atomic int *)realloc((void *)scratch.mateClaim, capacity * sizeof(_Atomic int));
+    scratch.capacity = capacity;
+}
+
+// Copy the living creatures into flat arrays for the neighbour sweep
+void GatherInteractionScratch()
+{
+    int count = LivingCreatures();
+    ReserveInteractionScratch(count);
+
+    int n = 0;
+    CreatureNode *current = creatureList;
+    while (current != NULL && n < count)
+    {
+        Creature *c = current->data;
+        scratch.items[n] = c;
+        scratch.ids[n] = c->id;
+        scratch.x[n] = c->position.x;
+        scratch.y[n] = c->position.y;
+        scratch.energy[n] = c->energy;
+        scratch.type[n] = c->type;
+        scratch.fertile[n] = c->type != GRASS && CanReproduce(c);
+        atomic_init(&scratch.preyClaim[n], -1);
+        atomic_init(&scratch.mateClaim[n], -1);
+        n++;
+        current = current->next;
+    }
+    scratch.count = n;
+}
+
+// Record index as the claimant of slot if its creature id is lower than the current claimant's
+void ClaimLowest(_Atomic int *slot, int index)
+{
+    int current = atomic_load_explicit(slot, memory_order_relaxed);
+    while (current < 0 || scratch.ids[index] < scratch.ids[current])
+    {
+        if (atomic_compare_exchange_weak_explicit(slot, &current, index, memory_order_relaxed, memory_order_relaxed))
+            return;
+    }
+}
+
+// Whether a creature is still alive after moving
+int Alive(const Creature *c)
+{
+    return c->energy > 0 && !isnan(c->energy);
+}
+
+// Contact pass for creatures [begin, end): claim prey and propose to mates found by the sweep
+void ClaimContacts(int begin, int end, void *context)
+{
+    const float reachSq = INTERACTION_RANGE * INTERACTION_RANGE;
+    for (int i = begin; i < end; i++)
+    {
+        const Species ti = scratch.type[i];
+        const unsigned int diet = speciesTable[ti].dietMask;
+        if ((diet == 0 && !scratch.fertile[i]) || !Alive(scratch.items[i]))
+            continue; // Neither eats nor mates (grass), or starved while moving
+        // An overflowed list is replaced by a rescan of everyone within reach
+        const int listed = scratch.contactCount[i] <= MAX_CONTACTS;
+        const int total = listed ? scratch.contactCount[i] : scratch.count;
+        const int *contacts = scratch.contacts + (size_t)i * MAX_CONTACTS;
+        for (int k = 0; k < total; k++)
+        {
+            int j = listed ? contacts[k] : k;
+            if (!listed)
+            {
+                float dx = scratch.x[i] - scratch.x[j];
+                float dy = scratch.y[i] - scratch.y[j];
+                if (dx * dx + dy * dy >= reachSq || j == i)
+                    continue;
+            }
+            if (!Alive(scratch.items[j]))
+                continue;
+            if (diet & SPECIES_BIT(scratch.type[j]))
+            {
+                // Lowest-id eater wins the prey
+                ClaimLowest(&scratch.preyClaim[j], i);
+            }
+            else if (scratch.type[j] == ti && scratch.fertile[i] && scratch.fertile[j])
+            {
+                // Each creature keeps its lowest-id suitor
+                ClaimLowest(&scratch.mateClaim[j], i);
+            }
+        }
+    }
+}
+
+// Settle eating and reproduction for the whole population, from the contacts found by the sweep
+// Contacts are claimed in parallel; the claims are then applied in creature order, so each prey
+// is eaten once and each creature mates at most once per tick, independent of thread timing
+void ResolveInteractions()
+{
+    ParallelFor(scratch.count, 64, ClaimContacts, NULL);
+
+    // Eating: the winning eater gains the prey's energy from after moving. An eater that is itself
+    // claimed as prey does not eat this tick, so nothing eaten is revived and no energy counts twice.
+    for (int j = 0; j < scratch.count; j++)
+    {
+        int eater = atomic_load_explicit(&scratch.preyClaim[j], memory_order_relaxed);
+        if (eater < 0 || atomic_load_explicit(&scratch.preyClaim[eater], memory_order_relaxed) >= 0)
+            continue;
+        Creature *predator = scratch.items[eater];
+        if (!Alive(predator))
+            continue; // Never feed a creature already marked for removal
+        SetCreatureEnergy(predator, predator->energy + scratch.energy[j]);
+        SetCreatureEnergy(scratch.items[j], -1); // Mark for removal
+    }
+
+    // Reproduction: pairs whose members chose each other, if neither was eaten
+    for (int i = 0; i < scratch.count; i++)
+    {
+        int partner = atomic_load_explicit(&scratch.mateClaim[i], memory_order_relaxed);
+        if (partner <= i || atomic_load_explicit(&scratch.mateClaim[partner], memory_order_relaxed) != i)
+            continue;
+        if (scratch.items[i]->energy <= 0 || scratch.items[partner]->energy <= 0)
+            continue;
+        // 70% chance to reproduce when conditions are met
+        if ((float)rand() / RAND_MAX < 0.7f)
+        {
+            if (BelowSoftCap())
+                CreateOffspring(scratch.items[i], scratch.items[partner]);
+            else
+                governor.birthsSuppressed++;
+        }
+    }
+}
+
+// Consider one other creature (or ghost) at offset (dx, dy) for the nearest food, predator and mate
+void SenseNeighbour(float dx, float dy, float distSq, unsigned int speciesBit, int fertileMate, SenseResult *sense)
+{
+    if (!((sense->dietMask | sense->predatorMask) & speciesBit) && !fertileMate)
+        return; // Neither food, predator nor mate
+    float dist = sqrtf(distSq);
+    if (dist > MAX_DETECTION_RANGE)
+        return;
+
+    Vector2 direction = {dx, dy};
+
+    // Food detection from the species table
+    if (sense->dietMask & speciesBit)
+    {
+        if (dist < sense->foodDist)
+        {
+            sense->foodDist = dist;
+            sense->foodDir = direction;
+        }
+    }
+
+    // Predator detection
+    if (sense->predatorMask & speciesBit)
+    {
+        if (dist < sense->predatorDist)
+        {
+            sense->predatorDist = dist;
+            sense->predatorDir = direction;
+        }
+    }
+
+    // Mate detection (same species and suitable for reproduction)
+    if (fertileMate)
+    {
+        if (dist < sense->mateDist)
+        {
+            sense->mateDist = dist;
+            sense->mateDir = direction;
+        }
+    }
+}
+
+// Process neural network inputs to determine creature movement
+void ProcessNeuralNetwork(const Creature *c, const SenseResult *sense, float output[OUTPUTS])
+{
+    // Initialize and validate inputs
+    float inputs[INPUTS];
+    for (int i = 0; i < INPUTS; i++)
+    {
+        inputs[i] = 0.0f;
+    }
+
+    // Basic environmental inputs (world coordinates, which differ from tile coordinates when sharded)
+    float worldX = c->position.x + worldOrigin.x;
+    float worldY = c->position.y + worldOrigin.y;
+    inputs[0] = worldX / worldSize.x; // Normalized x position
+    inputs[1] = worldY / worldSize.y; // Normalized y position
+    inputs[2] = c->energy / 1000.0f;  // Normalized energy level
+    // Replace age with boundary proximity (how close to edge of simulation)
+    float distToLeftBoundary = worldX;
+    float distToRightBoundary = worldSize.x - worldX;
+    float distToTopBoundary = worldY;
+    float distToBottomBoundary = worldSize.y - worldY;
+    float closestBoundaryDist = fminf(fminf(distToLeftBoundary, distToRightBoundary),
+                                      fminf(distToTopBoundary, distToBottomBoundary));
+    inputs[3] = fminf(1.0f, closestBoundaryDist / 100.0f); // Normalized boundary proximity
+
+    // Surroundings found by the neighbour sweep
+    float nearestFoodDist = sense->foodDist;
+    float nearestPredatorDist = sense->predatorDist;
+    float nearestMateDist = sense->mateDist;
+    Vector2 foodDir = sense->foodDir;
+    Vector2 predatorDir = sense->predatorDir;
+    Vector2 mateDir = sense->mateDir;
+
+    // Normalize and set sensory inputs
+    // Food inputs (4-7)
+    // Amplify the food proximity signal with a multiplier
+    float foodProximityMultiplier = 25.0f; // Increase to make food more attractive
+    inputs[4] = (nearestFoodDist == INFINITY) ? 0.0f : fminf(1.0f, (1.0f - (nearestFoodDist / MAX_DETECTION_RANGE)) * foodProximityMultiplier);
+
+    // Amplify directional signals to make creatures navigate more purposefully toward food
+    float foodDirectionMultiplier = 25.0f; // Strengthen directional pull toward food
+    inputs[5] = (nearestFoodDist == INFINITY) ? 0.0f : (foodDir.x / nearestFoodDist) * foodDirectionMultiplier;
+    inputs[6] = (nearestFoodDist == INFINITY) ? 0.0f : (foodDir.y / nearestFoodDist) * foodDirectionMultiplier;
+
+    // Adjust hunger threshold - make creatures seek food even at higher energy levels
+    inputs[7] = c->energy < 150.0f ? (1.0f - (c->energy / 150.0f)) : 0.0f; // Progressive hunger signal
+
+    // Predator inputs (8-11)
+    inputs[8] = (nearestPredatorDist == INFINITY) ? 0.0f : 25.0f - (nearestPredatorDist / MAX_DETECTION_RANGE);
+    inputs[9] = (nearestPredatorDist == INFINITY) ? 0.0f : predatorDir.x / nearestPredatorDist;
+    inputs[10] = (nearestPredatorDist == INFINITY) ? 0.0f : predatorDir.y / nearestPredatorDist;
+    inputs[11] = c->energy < 30.0f ? 5.0f : 0.0f; // Weakness signal
+
+    // Mate inputs (12-15)
+    inputs[12] = (nearestMateDist == INFINITY) ? 0.0f : 25.0f - (nearestMateDist / MAX_DETECTION_RANGE);
+    inputs[13] = (nearestMateDist == INFINITY) ? 0.0f : mateDir.x / nearestMateDist;
+    inputs[14] = (nearestMateDist == INFINITY) ? 0.0f : mateDir.y / nearestMateDist;
+    inputs[15] = CanReproduce(c) ? 10.0f : 0.0f; // Reproduction readiness
+
+    // Environmental awareness (16)
+    inputs[16] = c->speed / 15.5f; // Normalized speed
+
+    // Process inputs through the neural network layers
+    RunNetwork(&c->brain, inputs, output);
+}
+
+// Move a creature by its network output and charge the energy the movement cost
+void MoveCreature(Creature *c, float output[OUTPUTS])
+{
+    // Update position based on neural network output
+    // Output values are between 0-1, so subtract 0.5 to allow negative movement
+    // Update position based on neural network output
+
+    // Check for NaN values and replace them with defaults
+    if (isnan(output[0]) || isnan(output[1]))
+    {
+        output[0] = 0.5f;
+        output[1] = 0.5f;
+    }
+
+    c->position.x += (output[0] - 0.5f) * c->speed;
+    c->position.y += (output[1] - 0.5f) * c->speed;
+
+    // Clamp positions to world boundaries (a sharded tile lets creatures past its own edges to migrate)
+    c->position.x = fminf(fmaxf(c->position.x + worldOrigin.x, 32), worldSize.x - 32) - worldOrigin.x;
+    c->position.y = fminf(fmaxf(c->position.y + worldOrigin.y, 32), worldSize.y - 32) - worldOrigin.y;
+
+    // Calculate movement cost with validation
+    float movementX = (output[0] - 0.5f) * c->speed;
+    float movementY = (output[1] - 0.5f) * c->speed;
+
+    // Validate to avoid extreme values
+    if (isnan(movementX) || isnan(movementY))
+    {
+        movementX = 0;
+        movementY = 0;
+    }
+
+    float movementCost = fabsf(movementX) + fabsf(movementY);
+
+    // Different species have different energy efficiencies
+    float energyCost = speciesTable[c->type].energyCost;
+    float energy = c->energy - movementCost * energyCost;
+    // Validate energy to prevent NaN
+    if (isnan(energy))
+    {
+        energy = -1; // Mark for removal
+    }
+
+    // Ensure energy is within reasonable bounds
+    SetCreatureEnergy(c, fminf(energy, 1000.0f)); // Cap maximum energy
+}
+
+// Neighbour sweep for creatures [begin, end): one pass over the population finds the nearest
+// food, predator and mate for the network and lists the prey and mates within reach for the contact pass
+void SweepNeighbours(int begin, int end, void *context)
+{
+    const float reachSq = INTERACTION_RANGE * INTERACTION_RANGE;
+    const int n = scratch.count;
+    for (int i = begin; i < end; i++)
+    {
+        const Species ti = scratch.type[i];
+        scratch.contactCount[i] = 0;
+        if (ti == GRASS)
+            continue; // Grass neither thinks, eats nor mates
+
+        const float xi = scratch.x[i];
+        const float yi = scratch.y[i];
+        const unsigned int diet = speciesTable[ti].dietMask;
+        const int fertile = scratch.fertile[i];
+        int *contacts = scratch.contacts + (size_t)i * MAX_CONTACTS;
+        int contactCount = 0;
+        SenseResult sense = {INFINITY, INFINITY, INFINITY, {0, 0}, {0, 0}, {0, 0}, diet, speciesTable[ti].predatorMask};
+        for (int j = 0; j < n; j++)
+        {
+            if (j == i || scratch.energy[j] <= 0)
+                continue;
+            float dx = scratch.x[j] - xi;
+            float dy = scratch.y[j] - yi;
+            float distSq = dx * dx + dy * dy;
+            unsigned int speciesBit = SPECIES_BIT(scratch.type[j]);
+            int mate = scratch.type[j] == ti && scratch.fertile[j];
+            SenseNeighbour(dx, dy, distSq, speciesBit, mate, &sense);
+            if (distSq < reachSq && ((diet & speciesBit) || (mate && fertile)))
+            {
+                if (contactCount < MAX_CONTACTS)
+                    contacts[contactCount] = j;
+                contactCount++;
+            }
+        }
+        // Creatures just across a tile border (sharded world only)
+        for (int g = 0; g < ghostCount; g++)
+        {
+            float dx = ghosts[g].position.x - xi;
+            float dy = ghosts[g].position.y - yi;
+            SenseNeighbour(dx, dy, dx * dx + dy * dy, SPECIES_BIT(ghosts[g].type), ghosts[g].type == ti && ghosts[g].fertile, &sense);
+        }
+        scratch.contactCount[i] = contactCount;
+        ProcessNeuralNetwork(scratch.items[i], &sense, scratch.output + (size_t)i * OUTPUTS);
+    }
+}
+
+// Spread the low 16 bits of v so that bit i moves to bit 2i
+unsigned int SpreadBits(unsigned int v)
+{
+    v &= 0xFFFF;
+    v = (v | (v << 8)) & 0x00FF00FF;
+    v = (v | (v << 4)) & 0x0F0F0F0F;
+    v = (v | (v << 2)) & 0x33333333;
+    v = (v | (v << 1)) & 0x55555555;
+    return v;
+}
+
+// Z-curve index of a world position (16 bits per axis)
+unsigned int MortonCode(Vector2 position)
+{
+    float fx = fminf(fmaxf(position.x / WINDOW_WIDTH, 0.0f), 1.0f);
+    float fy = fminf(fmaxf(position.y / WINDOW_HEIGHT, 0.0f), 1.0f);
+    return SpreadBits((unsigned int)(fx * 65535.0f)) | (SpreadBits((unsigned int)(fy * 65535.0f)) << 1);
+}
+
+// Register a Creature pointer held outside the list so reorders keep it pointing at the same creature
+void RegisterCreatureHandle(Creature **handle)
+{
+    if (creatureHandleCount < MAX_CREATURE_HANDLES)
+        creatureHandles[creatureHandleCount++] = handle;
+}
+
+// Shared state of one parallel radix sort pass
+typedef struct
+{
+    const unsigned long long *src;
+    unsigned long long *dst;
+    int count;
+    int blocks;
+    int shift;
+    int (*histogram)[256]; // Per block digit counts, turned into write offsets
+} RadixPass;
+
+// Radix pass, step 1: count digits in each block
+void RadixHistogram(int begin, int end, void *context)
+{
+    RadixPass *pass = (RadixPass *)context;
+    for (int b = begin; b < end; b++)
+    {
+        int *counts = pass->histogram[b];
+        memset(counts, 0, 256 * sizeof(int));
+        int last = (b + 1) * RADIX_BLOCK < pass->count ? (b + 1) * RADIX_BLOCK : pass->count;
+        for (int i = b * RADIX_BLOCK; i < last; i++)
+            counts[(pass->src[i] >> pass->shift) & 0xFF]++;
+    }
+}
+
+// Radix pass, step 2: stable scatter of each block to its precomputed offsets
+void RadixScatter(int begin, int end, void *context)
+{
+    RadixPass *pass = (RadixPass *)context;
+    for (int b = begin; b < end; b++)
+    {
+        int *offsets = pass->histogram[b];
+        int last = (b + 1) * RADIX_BLOCK < pass->count ? (b + 1) * RADIX_BLOCK : pass->count;
+        for (int i = b * RADIX_BLOCK; i < last; i++)
+            pass->dst[offsets[(pass->src[i] >> pass->shift) & 0xFF]++] = pass->src[i];
+    }
+}
+
+// Sort 64-bit entries by their upper 32 bits with a parallel LSD radix sort; returns the sorted buffer
+unsigned long long *RadixSortUpper32(unsigned long long *keys, unsigned long long *temp, int count)
+{
+    RadixPass pass = {0};
+    pass.count = count;
+    pass.blocks = (count + RADIX_BLOCK - 1) / RADIX_BLOCK;
+    pass.histogram = (int(*)[256])malloc((pass.blocks > 0 ? pass.blocks : 1) * sizeof(*pass.histogram));
+
+    unsigned long long *src = keys;
+    unsigned long long *dst = temp;
+    for (int shift = 32; shift < 64; shift += 8)
+    {
+        pass.src = src;
+        pass.dst = dst;
+        pass.shift = shift;
+        ParallelFor(pass.blocks, 1, RadixHistogram, &pass);
+
+        // Exclusive prefix sum in (digit, block) order keeps the sort stable
+        int offset = 0;
+        int used = 0;
+        for (int d = 0; d < 256; d++)
+        {
+            int digitTotal = 0;
+            for (int b = 0; b < pass.blocks; b++)
+            {
+                int n = pass.histogram[b][d];
+                pass.histogram[b][d] = offset;
+                offset += n;
+                digitTotal += n;
+            }
+            used += digitTotal > 0;
+        }
+        if (used <= 1)
+            continue; // Every key has the same digit: this pass would not move anything
+
+        ParallelFor(pass.blocks, 1, RadixScatter, &pass);
+        unsigned long long *swap = src;
+        src = dst;
+        dst = swap;
+    }
+    free(pass.histogram);
+    return src;
+}
+
+// Compare two pointers by address (qsort callback)
+int CompareAddresses(const void *a, const void *b)
+{
+    uintptr_t pa = (uintptr_t)(*(void *const *)a);
+    uintptr_t pb = (uintptr_t)(*(void *const *)b);
+    return (pa > pb) - (pa < pb);
+}
+
+// Sort creature storage by Morton code: the list is relinked in Z-order and creature data, genomes
+// and list nodes are moved between their existing allocations so memory order follows the list
+void ReorderCreatures(CreatureNode **nodes, unsigned long long *keys, int count)
+{
+    unsigned long long *temp = (unsigned long long *)malloc(count * sizeof(unsigned long long));
+    unsigned long long *sorted = RadixSortUpper32(keys, temp, count);
+
+    Creature **oldCreatures = (Creature **)malloc(count * sizeof(Creature *));
+    Creature **slots = (Creature **)malloc(count * sizeof(Creature *));
+    float **geneSlots = (float **)malloc(count * sizeof(float *));
+    Creature *values = (Creature *)malloc(count * sizeof(Creature));
+    int genomes = 0;
+    for (int i = 0; i < count; i++)
+    {
+        oldCreatures[i] = nodes[i]->data;
+        slots[i] = nodes[i]->data;
+        if (nodes[i]->data->brain.genes != NULL)
+            geneSlots[genomes++] = nodes[i]->data->brain.genes;
+    }
+    float *geneValues = (float *)malloc(((size_t)genomes * topology.genomeLength + 1) * sizeof(float));
+
+    // Copy creatures and genomes out in Z-order
+    int g = 0;
+    for (int k = 0; k < count; k++)
+    {
+        Creature *c = oldCreatures[(unsigned int)sorted[k]];
+        values[k] = *c;
+        if (c->brain.genes != NULL)
+            memcpy(geneValues + (size_t)g++ * topology.genomeLength, c->brain.genes, topology.genomeLength * sizeof(float));
+    }
+
+    // Write them back into the allocations sorted by address
+    qsort(slots, count, sizeof(Creature *), CompareAddresses);
+    qsort(geneSlots, genomes, sizeof(float *), CompareAddresses);
+    qsort(nodes, count, sizeof(CreatureNode *), CompareAddresses);
+    g = 0;
+    for (int k = 0; k < count; k++)
+    {
+        *slots[k] = values[k];
+        if (values[k].brain.genes != NULL)
+        {
+            slots[k]->brain.genes = geneSlots[g];
+            memcpy(geneSlots[g], geneValues + (size_t)g * topology.genomeLength, topology.genomeLength * sizeof(float));
+            g++;
+        }
+        nodes[k]->data = slots[k];
+        nodes[k]->next = (k + 1 < count) ? nodes[k + 1] : NULL;
+    }
+    creatureList = nodes[0];
+
+    // Fix up external pointers: the creature at oldCreatures[sorted[k]] now lives at slots[k]
+    for (int h = 0; h < creatureHandleCount; h++)
+    {
+        Creature *target = *creatureHandles[h];
+        if (target == NULL)
+            continue;
+        for (int k = 0; k < count; k++)
+        {
+            if (oldCreatures[(unsigned int)sorted[k]] == target)
+            {
+                *creatureHandles[h] = slots[k];
+                break;
+            }
+        }
+    }
+
+    free(geneValues);
+    free(values);
+    free(geneSlots);
+    free(slots);
+    free(oldCreatures);
+    free(temp);
+    reorderCount++;
+}
+
+// Periodically measure how far list order has drifted from Z-order and reorder when it is too far
+void MaybeReorderCreatures()
+{
+    if (simTick % REORDER_CHECK_INTERVAL != 0 || creatureList == NULL)
+        return;
+
+    int count = LivingCreatures();
+    CreatureNode **nodes = (CreatureNode **)malloc(count * sizeof(CreatureNode *));
+    unsigned long long *keys = (unsigned long long *)malloc(count * sizeof(unsigned long long));
+
+    // Key: Morton code in the upper half, list position in the lower half
+    int n = 0;
+    int outOfOrder = 0;
+    unsigned int previous = 0;
+    CreatureNode *current = creatureList;
+    while (current != NULL && n < count)
+    {
+        unsigned int code = MortonCode(current->data->position);
+        outOfOrder += n > 0 && code < previous;
+        previous = code;
+        nodes[n] = current;
+        keys[n] = ((unsigned long long)code << 32) | (unsigned int)n;
+        n++;
+        current = current->next;
+    }
+    orderDrift = n > 1 ? (float)outOfOrder / (n - 1) : 0;
+
+    if (orderDrift > REORDER_DRIFT_THRESHOLD)
+        ReorderCreatures(nodes, keys, n);
+    free(keys);
+    free(nodes);
+}
+
+// Update all creatures in the simulation for one frame
+void UpdateCreatures()
+{
+    simTick++;
+    MaybeReorderCreatures();
+
+    // Sense and think in one parallel sweep over a snapshot of the population, then move
+    double thinkStart = NowSeconds();
+    GatherInteractionScratch();
+    ParallelFor(scratch.count, 64, SweepNeighbours, NULL);
+    for (int i = 0; i < scratch.count; i++)
+    {
+        Creature *c = scratch.items[i];
+        if (c->type != GRASS)
+        {
+            MoveCreature(c, scratch.output + (size_t)i * OUTPUTS);
+        }
+        AgeCreature(c);
+        c->last_mate++;
+
+        if (c->type != GRASS)
+        {
+            SetCreatureEnergy(c, c->energy - 0.005f); // Energy cost for existing
+        }
+        scratch.energy[i] = c->energy;
+    }
+    thinkSeconds = NowSeconds() - thinkStart;
+
+    // Settle eating and reproduction between the survivors, then drop the starved and the eaten
+    double interactStart = NowSeconds();
+    ResolveInteractions();
+    RemoveDeadCreatures();
+    interactSeconds = NowSeconds() - interactStart;
+
+    // Add random grass (the governor may withhold some spawns, and counts each one)
+    float grassRoll = (float)rand() / RAND_MAX;
+    if (grassRoll < GRASS_SPAWN_CHANCE &&
+        (grassRoll >= GRASS_SPAWN_CHANCE * governor.grassSpawnScale || !BelowSoftCap()))
+    {
+        governor.grassSuppressed++;
+    }
+    else if (grassRoll < GRASS_SPAWN_CHANCE)
+    {
+        Creature *grass = AllocCreature(ALLOC_GRASS);
+        if (grass == NULL)
+            return;
+        grass->position = (Vector2){50 + rand() % (WINDOW_WIDTH - 100), 50 + rand() % (WINDOW_HEIGHT - 100)};
+        grass->speed = 0;
+        grass->energy = speciesTable[GRASS].startEnergy;
+        grass->type = GRASS;
+        grass->age = 0;
+        grass->last_mate = 0;
+        grass->color = speciesTable[GRASS].color;
+        grass->brain = (NeuralNetwork){0};
+        AddCreature(grass);
+    }
+}
+
+// Fold a bucket into an aggregate of `folded` earlier buckets, out of `fanout` equal-length buckets
+void FoldHistoryBucket(HistoryBucket *aggregate, int folded, const HistoryBucket *bucket, int fanout)
+{
+    for (int i = 0; i < SPECIES_COUNT; i++)
+    {
+        aggregate->min[i] = folded == 0 ? bucket->min[i] : fminf(aggregate->min[i], bucket->min[i]);
+        aggregate->max[i] = folded == 0 ? bucket->max[i] : fmaxf(aggregate->max[i], bucket->max[i]);
+        aggregate->mean[i] = (folded == 0 ? 0 : aggregate->mean[i]) + bucket->mean[i] / fanout;
+    }
+    aggregate->tick = bucket->tick;
+}
+
+// Merge neighbouring buckets of a full coarsest level in place, halving it, so it never drops the start of the run
+void CompactHistory(HistoryLevel *h)
+{
+    static HistoryBucket merged[HISTORY_LENGTH / 2];
+    int first = (h->head - h->count + HISTORY_LENGTH) % HISTORY_LENGTH;
+    for (int k = 0; k < HISTORY_LENGTH / 2; k++)
+    {
+        FoldHistoryBucket(&merged[k], 0, &h->buckets[(first + 2 * k) % HISTORY_LENGTH], 2);
+        FoldHistoryBucket(&merged[k], 1, &h->buckets[(first + 2 * k + 1) % HISTORY_LENGTH], 2);
+    }
+    memcpy(h->buckets, merged, sizeof(merged));
+    h->count = HISTORY_LENGTH / 2;
+    h->head = HISTORY_LENGTH / 2;
+    h->span *= 2;
+}
+
+// Append a bucket to a history level and fold it into the next, coarser level
+void PushHistory(int level, const HistoryBucket *bucket)
+{
+    HistoryLevel *h = &history[level];
+    if (level == HISTORY_LEVELS - 1)
+    {
+        // The coarsest level keeps the whole run: once compacted, it stores one bucket per `span` arriving
+        if (h->span == 0)
+            h->span = 1;
+        if (h->span > 1)
+        {
+            FoldHistoryBucket(&h->pending, h->pendingCount, bucket, h->span);
+            if (++h->pendingCount < h->span)
+                return;
+            h->pendingCount = 0;
+            bucket = &h->pending;
+        }
+    }
+    h->buckets[h->head] = *bucket;
+    h->head = (h->head + 1) % HISTORY_LENGTH;
+    if (h->count < HISTORY_LENGTH)
+        h->count++;
+    h->pushed++;
+    if (level == HISTORY_LEVELS - 1)
+    {
+        if (h->count == HISTORY_LENGTH)
+            CompactHistory(h);
+        return;
+    }
+
+    FoldHistoryBucket(&h->pending, h->pendingCount, bucket, HISTORY_FANOUT);
+    if (++h->pendingCount == HISTORY_FANOUT)
+    {
+        h->pendingCount = 0;
+        PushHistory(level + 1, &h->pending);
+    }
+}
+
+// Record the population counts of the tick that just finished
+void RecordHistory(long long tick, const int counts[SPECIES_COUNT])
+{
+    HistoryBucket bucket = {.tick = tick};
+    for (int i = 0; i < SPECIES_COUNT; i++)
+        bucket.min[i] = bucket.max[i] = bucket.mean[i] = (float)counts[i];
+    PushHistory(0, &bucket);
+}
+
+// Largest-Triangle-Three-Buckets: pick threshold of the n points that best keep the shape of the line
+// Writes the chosen indices to selected and returns how many there are
+int DownsampleLTTB(const float *x, const float *y, int n, int threshold, int *selected)
+{
+    if (threshold >= n || threshold < 3)
+    {
+        for (int i = 0; i < n; i++)
+            selected[i] = i;
+        return n;
+    }
+
+    int count = 0;
+    int a = 0; // Previously selected point
+    float every = (float)(n - 2) / (threshold - 2);
+    selected[count++] = 0;
+    for (int b = 0; b < threshold - 2; b++)
+    {
+        // Average of the next bucket is the third corner of the triangle
+        int nextStart = (int)((b + 1) * every) + 1;
+        int nextEnd = (int)((b + 2) * every) + 1;
+        if (nextEnd > n)
+            nextEnd = n;
+        float avgX = 0, avgY = 0;
+        for (int i = nextStart; i < nextEnd; i++)
+        {
+            avgX += x[i];
+            avgY += y[i];
+        }
+        if (nextEnd > nextStart)
+        {
+            avgX /= nextEnd - nextStart;
+            avgY /= nextEnd - nextStart;
+        }
+
+        // Keep the point of this bucket spanning the largest triangle
+        int start = (int)(b * every) + 1;
+        int end = (int)((b + 1) * every) + 1;
+        float bestArea = -1;
+        int best = start;
+        for (int i = start; i < end; i++)
+        {
+            float area = fabsf((x[a] - avgX) * (y[i] - y[a]) - (x[a] - x[i]) * (avgY - y[a]));
+            if (area > bestArea)
+            {
+                bestArea = area;
+                best = i;
+            }
+        }
+        selected[count++] = best;
+        a = best;
+    }
+    selected[count++] = n - 1;
+    return count;
+}
+
+// Draw the population history of every species in area, downsampled to the area's width
+void DrawPopulationHistory(Rectangle area)
+{
+    // Finest level that still holds the whole run (or the coarsest one)
+    int level = 0;
+    while (level < HISTORY_LEVELS - 1 && history[level].pushed > HISTORY_LENGTH)
+        level++;
+    const HistoryLevel *h = &history[level];
+    if (h->count < 2)
+        return;
+
+    static float x[HISTORY_LENGTH], y[HISTORY_LENGTH];
+    static int selected[HISTORY_LENGTH];
+    int first = (h->head - h->count + HISTORY_LENGTH) % HISTORY_LENGTH;
+    float top = 1;
+    for (int k = 0; k < h->count; k++)
+    {
+        const HistoryBucket *bucket = &h->buckets[(first + k) % HISTORY_LENGTH];
+        x[k] = (float)bucket->tick;
+        for (int i = 0; i < SPECIES_COUNT; i++)
+            top = fmaxf(top, bucket->max[i]);
+    }
+    float firstTick = x[0], span = fmaxf(x[h->count - 1] - x[0], 1);
+
+    DrawRectangleRec(area, Fade(RAYWHITE, 0.85f));
+    DrawRectangleLinesEx(area, 1, LIGHTGRAY);
+    DrawText(TextFormat("Population, ticks %.0f-%.0f (peak %.0f)", firstTick, x[h->count - 1], top),
+             (int)area.x + 4, (int)area.y + 4, 10, DARKGRAY);
+    for (int i = 0; i < SPECIES_COUNT; i++)
+    {
+        for (int k = 0; k < h->count; k++)
+            y[k] = h->buckets[(first + k) % HISTORY_LENGTH].mean[i];
+        int points = DownsampleLTTB(x, y, h->count, (int)area.width / 2, selected);
+        Vector2 previous = {0};
+        for (int p = 0; p < points; p++)
+        {
+            const HistoryBucket *bucket = &h->buckets[(first + selected[p]) % HISTORY_LENGTH];
+            float px = area.x + (x[selected[p]] - firstTick) / span * area.width;
+            // Min/max envelope of the bucket, then the mean line
+            DrawLine((int)px, (int)(area.y + area.height - bucket->min[i] / top * area.height),
+                     (int)px, (int)(area.y + area.height - bucket->max[i] / top * area.height),
+                     Fade(speciesTable[i].color, 0.25f));
+            Vector2 point = {px, area.y + area.height - y[selected[p]] / top * area.height};
+            if (p > 0)
+                DrawLineV(previous, point, speciesTable[i].color);
+            previous = point;
+        }
+    }
+}
+
+// Pick up the latest strategy medoids for tinting, without waiting on the diversity thread
+void RefreshDrawMedoids()
+{
+    if (drawMedoids[0] == NULL || pthread_mutex_trylock(&diversityResultsLock) != 0)
+        return;
+    if (drawEpoch != strategyEpoch)
+    {
+        for (int i = 0; i < SPECIES_COUNT; i++)
+        {
+            drawStrategies[i] = diversityResults.strategies[i];
+            memcpy(drawMedoids[i], strategyMedoids[i], (size_t)drawStrategies[i] * topology.genomeLength * sizeof(float));
+        }
+        drawEpoch = strategyEpoch;
+    }
+    pthread_mutex_unlock(&diversityResultsLock);
+}
+
+// Genome floats StrategyTint() may still compare this frame
+long long tintBudget = 0;
+
+// Tint of a creature's strategy; each brain is matched to the medoids once per clustering.
+// Re-matching after a new clustering is spread over frames by tintBudget; until then a creature keeps
+// its previous strategy (strategies are ordered by size, so the index usually still fits).
+Color StrategyTint(Creature *c)
+{
+    static const Color palette[MAX_STRATEGIES] = {WHITE, SKYBLUE, PINK, GOLD, VIOLET, LIME};
+    if (c->type == GRASS || drawStrategies[c->type] < 2)
+        return WHITE;
+    if (c->strategyEpoch != drawEpoch)
+    {
+        if (tintBudget <= 0)
+            return c->strategyEpoch != 0 && c->strategy < drawStrategies[c->type] ? palette[c->strategy] : WHITE;
+        tintBudget -= (long long)drawStrategies[c->type] * topology.genomeLength;
+        const float *medoids = drawMedoids[c->type];
+        float best = INFINITY;
+        for (int m = 0; m < drawStrategies[c->type]; m++)
+        {
+            float d = GenomeDistanceSq(c->brain.genes, medoids + (size_t)m * topology.genomeLength, topology.genomeLength);
+            if (d < best)
+            {
+                best = d;
+                c->strategy = (unsigned char)m;
+            }
+        }
+        c->strategyEpoch = drawEpoch;
+    }
+    return palette[c->strategy];
+}
+
+// Draw all creatures to the screen
+void DrawCreatures()
+{
+    if (strategyTint)
+    {
+        RefreshDrawMedoids();
+        tintBudget = STRATEGY_TINT_BUDGET;
+    }
+    CreatureNode *current = creatureList;
+    while (current != NULL)
+    {
+        // Draw energy level as text
+        DrawText(TextFormat("e:%.0f a:%d", current->data->energy, current->data->age),
+                 (int)(current->data->position.x - 17),
+                 (int)(current->data->position.y + 17),
+                 10,
+                 current->data->color);
+
+        // Draw creature based on type
+        Texture2D icon = speciesIcons[current->data->type];
+        DrawTexturePro(icon,
+                       (Rectangle){0, 0, icon.width, icon.height},
+                       (Rectangle){current->data->position.x - 16, current->data->position.y - 16, 32, 32},
+                       (Vector2){0, 0}, 0, strategyTint ? StrategyTint(current->data) : WHITE);
+        current = current->next;
+    }
+    for (size_t i = 0; i < MAX_HEARTH_EFFECTS; i++)
+    {
+        if (hearthEffects[i].age > 0 && hearthEffects[i].age < 500)
+        {
+            DrawText("sex", hearthEffects[i].position.x, hearthEffects[i].position.y, 20, RED);
+            hearthEffects[i].age++;
+        }
+        else if (hearthEffects[i].age >= 500)
+        {
+            hearthEffects[i].age = 0;
+            hearthEffects[i].position = (Vector2){0, 0};
+        }
+    }
+}
+
+// Rebuild the running population sums exactly by walking the list (removes floating point drift)
+void RecomputePopulationStats()
+{
+    population = (PopulationStats){0};
+    CreatureNode *current = creatureList;
+    while (current != NULL)
+    {
+        TrackCreature(current->data, 1);
+        current = current->next;
+    }
+}
+
+// Mean and variance of one species from running sums
+void Moments(int count, double sum, double sumSq, float *mean, float *variance)
+{
+    if (count <= 0)
+    {
+        *mean = 0;
+        *variance = 0;
+        return;
+    }
+    double m = sum / count;
+    *mean = m;
+    *variance = fmax(0.0, sumSq / count - m * m);
+}
+
+// Hand a strided sample of each species' brains to the diversity thread if it is idle
+void SampleBrains()
+{
+    if (!diversityStarted || pthread_mutex_trylock(&diversityLock) != 0)
+        return;
+    if (!diversityPending)
+    {
+        int stride[SPECIES_COUNT];
+        int seen[SPECIES_COUNT] = {0};
+        for (int i = 0; i < SPECIES_COUNT; i++)
+        {
+            stride[i] = population.count[i] > DIVERSITY_SAMPLE ? population.count[i] / DIVERSITY_SAMPLE : 1;
+            diversityCounts[i] = 0;
+            diversityPopulation[i] = population.count[i];
+        }
+        CreatureNode *current = creatureList;
+        while (current != NULL)
+        {
+            Creature *c = current->data;
+            if (c->type != GRASS && seen[c->type]++ % stride[c->type] == 0 && diversityCounts[c->type] < DIVERSITY_SAMPLE)
+            {
+                memcpy(diversityGenes[c->type] + (size_t)diversityCounts[c->type]++ * topology.genomeLength,
+                       c->brain.genes, topology.genomeLength * sizeof(float));
+            }
+            current = current->next;
+        }
+        diversityTick = simTick;
+        diversityPending = 1;
+        pthread_cond_signal(&diversityWake);
+    }
+    pthread_mutex_unlock(&diversityLock);
+}
+
+// Compute per-weight variance and sampled mean pairwise distance for one species
+void MeasureDiversity(const float *genes, int count, double *sum, double *sumSq, unsigned int *seed,
+                      float *weightVariance, float *pairwiseDistance)
+{
+    const int weights = topology.genomeLength;
+    for (int k = 0; k < weights; k++)
+    {
+        sum[k] = 0;
+        sumSq[k] = 0;
+    }
+
+    for (int i = 0; i < count; i++)
+    {
+        const float *w = genes + (size_t)i * weights;
+        for (int k = 0; k < weights; k++)
+        {
+            sum[k] += w[k];
+            sumSq[k] += (double)w[k] * w[k];
+        }
+    }
+    double varianceTotal = 0;
+    for (int k = 0; k < weights; k++)
+    {
+        double mean = sum[k] / count;
+        varianceTotal += fmax(0.0, sumSq[k] / count - mean * mean);
+    }
+    *weightVariance = varianceTotal / weights;
+
+    // Exhaustive for small samples, random pairs otherwise
+    long long allPairs = (long long)count * (count - 1) / 2;
+    double distanceTotal = 0;
+    long long pairs = 0;
+    for (long long p = 0; p < allPairs && p < DIVERSITY_PAIRS; p++)
+    {
+        int a, b;
+        if (allPairs <= DIVERSITY_PAIRS)
+        {
+            // Decode the p-th pair (a < b) in row order
+            a = 0;
+            long long rest = p;
+            while (rest >= count - 1 - a)
+            {
+                rest -= count - 1 - a;
+                a++;
+            }
+            b = a + 1 + (int)rest;
+        }
+        else
+        {
+            a = rand_r(seed) % count;
+            b = rand_r(seed) % (count - 1);
+            if (b >= a)
+                b++;
+        }
+        distanceTotal += sqrtf(GenomeDistanceSq(genes + (size_t)a * weights, genes + (size_t)b * weights, weights));
+        pairs++;
+    }
+    *pairwiseDistance = pairs > 0 ? distanceTotal / pairs : 0;
+}
+
+// Assign each of the count samples to its nearest medoid
+void AssignToMedoids(const float *distance, int count, const int *medoids, int k, int *assignment)
+{
+    for (int i = 0; i < count; i++)
+    {
+        int best = 0;
+        for (int m = 1; m < k; m++)
+        {
+            if (distance[(size_t)i * count + medoids[m]] < distance[(size_t)i * count + medoids[best]])
+                best = m;
+        }
+        assignment[i] = best;
+    }
+}
+
+// k-medoids on a precomputed distance matrix; returns the mean silhouette of the clustering
+float ClusterMedoids(const float *distance, int count, int k, int *medoids, int *assignment)
+{
+    // Start from the most central sample, then repeatedly add the sample farthest from every medoid
+    float bestTotal = INFINITY;
+    for (int i = 0; i < count; i++)
+    {
+        float total = 0;
+        for (int j = 0; j < count; j++)
+            total += distance[(size_t)i * count + j];
+        if (total < bestTotal)
+        {
+            bestTotal = total;
+            medoids[0] = i;
+        }
+    }
+    for (int m = 1; m < k; m++)
+    {
+        float farthest = -1;
+        for (int i = 0; i < count; i++)
+        {
+            float nearest = INFINITY;
+            for (int n = 0; n < m; n++)
+                nearest = fminf(nearest, distance[(size_t)i * count + medoids[n]]);
+            if (nearest > farthest)
+            {
+                farthest = nearest;
+                medoids[m] = i;
+            }
+        }
+    }
+
+    // Alternate assignment and per-cluster medoid updates until they settle
+    for (int iteration = 0; iteration < KMEDOIDS_ITERATIONS; iteration++)
+    {
+        AssignToMedoids(distance, count, medoids, k, assignment);
+        int changed = 0;
+        for (int m = 0; m < k; m++)
+        {
+            float best = INFINITY;
+            int bestMember = medoids[m];
+            for (int i = 0; i < count; i++)
+            {
+                if (assignment[i] != m)
+                    continue;
+                float total = 0;
+                for (int j = 0; j < count; j++)
+                {
+                    if (assignment[j] == m)
+                        total += distance[(size_t)i * count + j];
+                }
+                if (total < best)
+                {
+                    best = total;
+                    bestMember = i;
+                }
+            }
+            changed |= bestMember != medoids[m];
+            medoids[m] = bestMember;
+        }
+        if (!changed)
+            break;
+    }
+    AssignToMedoids(distance, count, medoids, k, assignment);
+
+    // Mean silhouette: how much closer each sample is to its own cluster than to the next nearest
+    double silhouette = 0;
+    for (int i = 0; i < count; i++)
+    {
+        float sum[MAX_STRATEGIES] = {0};
+        int size[MAX_STRATEGIES] = {0};
+        for (int j = 0; j < count; j++)
+        {
+            sum[assignment[j]] += distance[(size_t)i * count + j];
+            size[assignment[j]]++;
+        }
+        int own = assignment[i];
+        if (size[own] < 2)
+            continue; // Singletons score 0
+        float a = sum[own] / (size[own] - 1);
+        float b = INFINITY;
+        for (int m = 0; m < k; m++)
+        {
+            if (m != own && size[m] > 0)
+                b = fminf(b, sum[m] / size[m]);
+        }
+        float spread = fmaxf(a, b);
+        if (spread > 0 && b != INFINITY)
+            silhouette += (b - a) / spread;
+    }
+    return (float)(silhouette / count);
+}
+
+// Split one species' sampled brains into strategies; writes medoid genomes, largest strategy first
+// Returns the number of strategies and fills sizes with the sampled brains in each
+int FindStrategies(const float *genes, int count, float *distance, int *assignment, float *medoidGenes, int sizes[MAX_STRATEGIES])
+{
+    const int weights = topology.genomeLength;
+    for (int i = 0; i < count; i++)
+    {
+        distance[(size_t)i * count + i] = 0;
+        for (int j = i + 1; j < count; j++)
+        {
+            float d = sqrtf(GenomeDistanceSq(genes + (size_t)i * weights, genes + (size_t)j * weights, weights));
+            distance[(size_t)i * count + j] = d;
+            distance[(size_t)j * count + i] = d;
+        }
+    }
+
+    // Keep the k with the best silhouette, if it is convincing enough
+    int medoids[MAX_STRATEGIES], bestMedoids[MAX_STRATEGIES];
+    int trial[DIVERSITY_SAMPLE];
+    int k = 1;
+    float bestSilhouette = STRATEGY_MIN_SILHOUETTE;
+    for (int candidate = 2; candidate <= MAX_STRATEGIES && candidate * 4 <= count; candidate++)
+    {
+        float silhouette = ClusterMedoids(distance, count, candidate, medoids, trial);
+        if (silhouette > bestSilhouette)
+        {
+            bestSilhouette = silhouette;
+            k = candidate;
+            memcpy(bestMedoids, medoids, sizeof(medoids));
+            memcpy(assignment, trial, count * sizeof(int));
+        }
+    }
+    if (k == 1)
+        ClusterMedoids(distance, count, 1, bestMedoids, assignment);
+
+    // Order strategies by size
+    int order[MAX_STRATEGIES];
+    for (int m = 0; m < k; m++)
+    {
+        sizes[m] = 0;
+        order[m] = m;
+    }
+    for (int i = 0; i < count; i++)
+        sizes[assignment[i]]++;
+    for (int a = 1; a < k; a++)
+    {
+        for (int b = a; b > 0 && sizes[order[b]] > sizes[order[b - 1]]; b--)
+        {
+            int swap = order[b];
+            order[b] = order[b - 1];
+            order[b - 1] = swap;
+        }
+    }
+    int sorted[MAX_STRATEGIES];
+    for (int m = 0; m < k; m++)
+    {
+        sorted[m] = sizes[order[m]];
+        memcpy(medoidGenes + (size_t)m * weights, genes + (size_t)bestMedoids[order[m]] * weights, weights * sizeof(float));
+    }
+    memcpy(sizes, sorted, k * sizeof(int));
+    return k;
+}
+
+// Diversity thread: wait for a snapshot, analyse it, publish the results
+void *DiversityThreadMain(void *arg)
+{
+    unsigned int seed = config.seed;
+    double *sum = (double *)malloc(topology.genomeLength * sizeof(double));
+    double *sumSq = (double *)malloc(topology.genomeLength * sizeof(double));
+    float *distance = (float *)malloc((size_t)DIVERSITY_SAMPLE * DIVERSITY_SAMPLE * sizeof(float));
+    float *medoids = (float *)malloc((size_t)SPECIES_COUNT * MAX_STRATEGIES * topology.genomeLength * sizeof(float));
+    int assignment[DIVERSITY_SAMPLE];
+    for (;;)
+    {
+        pthread_mutex_lock(&diversityLock);
+        while (!diversityPending && !diversityStop)
+            pthread_cond_wait(&diversityWake, &diversityLock);
+        int stop = diversityStop;
+        pthread_mutex_unlock(&diversityLock);
+        if (stop)
+            break;
+
+        DiversityMetrics metrics = {0};
+        metrics.tick = diversityTick;
+        for (int i = 0; i < SPECIES_COUNT; i++)
+        {
+            metrics.samples[i] = diversityCounts[i];
+            if (diversityCounts[i] >= 2)
+                MeasureDiversity(diversityGenes[i], diversityCounts[i], sum, sumSq, &seed,
+                                 &metrics.weightVariance[i], &metrics.pairwiseDistance[i]);
+            if (diversityCounts[i] >= 1)
+            {
+                // Sample sizes scale up to the population at the time of the snapshot
+                int sizes[MAX_STRATEGIES];
+                float *speciesMedoids = medoids + (size_t)i * MAX_STRATEGIES * topology.genomeLength;
+                metrics.strategies[i] = FindStrategies(diversityGenes[i], diversityCounts[i], distance, assignment, speciesMedoids, sizes);
+                for (int m = 0; m < metrics.strategies[i]; m++)
+                    metrics.strategySizes[i][m] = (int)((double)sizes[m] * diversityPopulation[i] / diversityCounts[i] + 0.5);
+            }
+        }
+
+        pthread_mutex_lock(&diversityResultsLock);
+        diversityResults = metrics;
+        for (int i = 0; i < SPECIES_COUNT; i++)
+        {
+            memcpy(strategyMedoids[i], medoids + (size_t)i * MAX_STRATEGIES * topology.genomeLength,
+                   (size_t)metrics.strategies[i] * topology.genomeLength * sizeof(float));
+        }
+        strategyEpoch++;
+        pthread_mutex_unlock(&diversityResultsLock);
+
+        pthread_mutex_lock(&diversityLock);
+        diversityPending = 0;
+        pthread_mutex_unlock(&diversityLock);
+    }
+    free(sum);
+    free(sumSq);
+    free(distance);
+    free(medoids);
+    return NULL;
+}
+
+// Start the background diversity analysis
+void StartDiversityThread()
+{
+    diversityStop = 0;
+    for (int i = 0; i < SPECIES_COUNT; i++)
+    {
+        diversityGenes[i] = (float *)malloc((size_t)DIVERSITY_SAMPLE * topology.genomeLength * sizeof(float));
+        strategyMedoids[i] = (float *)malloc((size_t)MAX_STRATEGIES * topology.genomeLength * sizeof(float));
+        drawMedoids[i] = (float *)malloc((size_t)MAX_STRATEGIES * topology.genomeLength * sizeof(float));
+    }
+    diversityStarted = pthread_create(&diversityThread, NULL, DiversityThreadMain, NULL) == 0;
+}
+
+// Stop the background diversity analysis
+void StopDiversityThread()
+{
+    if (!diversityStarted)
+        return;
+    pthread_mutex_lock(&diversityLock);
+    diversityStop = 1;
+    pthread_cond_signal(&diversityWake);
+    pthread_mutex_unlock(&diversityLock);
+    pthread_join(diversityThread, NULL);
+    diversityStarted = 0;
+    for (int i = 0; i < SPECIES_COUNT; i++)
+    {
+        free(diversityGenes[i]);
+        free(strategyMedoids[i]);
+        free(drawMedoids[i]);
+        diversityGenes[i] = NULL;
+        strategyMedoids[i] = NULL;
+        drawMedoids[i] = NULL;
+    }
+}
+
+// Peak resident set size of the process in bytes
+long long ReadPeakResidentBytes()
+{
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0)
+        return 0;
+#ifdef __APPLE__
+    return usage.ru_maxrss; // Bytes on macOS
+#else
+    return usage.ru_maxrss * 1024LL; // Kilobytes elsewhere
+#endif
+}
+
+// Resident set size of the process in bytes (peak RSS where the current value is unavailable)
+long long ReadResidentBytes()
+{
+#ifdef __linux__
+    FILE *statm = fopen("/proc/self/statm", "r");
+    if (statm != NULL)
+    {
+        long long pages = 0, residentPages = 0;
+        int matched = fscanf(statm, "%lld %lld", &pages, &residentPages);
+        fclose(statm);
+        if (matched == 2)
+            return residentPages * sysconf(_SC_PAGESIZE);
+    }
+#endif
+    return ReadPeakResidentBytes();
+}
+
+// Copy stats into the published block (single writer: the simulation thread)
+void WriteStats(const SimStats *stats)
+{
+    unsigned int seq = atomic_load_explicit(&statsSequence, memory_order_relaxed);
+    atomic_store_explicit(&statsSequence, seq + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    memcpy(&publishedStats, stats, sizeof(SimStats));
+    atomic_store_explicit(&statsSequence, seq + 2, memory_order_release);
+}
+
+// Read a consistent copy of the published stats, retrying if a write was in progress
+void ReadStats(SimStats *stats)
+{
+    unsigned int before, after;
+    do
+    {
+        before = atomic_load_explicit(&statsSequence, memory_order_acquire);
+        memcpy(stats, &publishedStats, sizeof(SimStats));
+        atomic_thread_fence(memory_order_acquire);
+        after = atomic_load_explicit(&statsSequence, memory_order_relaxed);
+    } while ((before & 1) || before != after);
+}
+
+// Gather statistics for the tick that just finished and publish them
+void PublishStats(SimStats *stats, double updateSeconds, double drawSeconds)
+{
+    // Rates and memory are refreshed once per second
+    static double rateStart = 0;
+    static long long rateTick = 0;
+    static long long rateBirths[SPECIES_COUNT] = {0};
+    static long long rateDeaths[SPECIES_COUNT] = {0};
+
+    if (simTick % STATS_RESYNC_INTERVAL == 0)
+        RecomputePopulationStats();
+    if (simTick % DIVERSITY_INTERVAL == 0)
+        SampleBrains();
+
+    stats->tick = simTick;
+    for (int i = 0; i < SPECIES_COUNT; i++)
+    {
+        int n = population.count[i];
+        stats->counts[i] = n;
+        Moments(n, population.energySum[i], population.energySumSq[i], &stats->energyMean[i], &stats->energyVariance[i]);
+        Moments(n, population.ageSum[i], population.ageSumSq[i], &stats->ageMean[i], &stats->ageVariance[i]);
+        Moments(n, population.speedSum[i], population.speedSumSq[i], &stats->speedMean[i], &stats->speedVariance[i]);
+        stats->births[i] = birthTotals[i];
+        stats->deaths[i] = deathTotals[i];
+    }
+    stats->updateSeconds = updateSeconds;
+    stats->thinkSeconds = thinkSeconds;
+    stats->interactSeconds = interactSeconds;
+    stats->drawSeconds = drawSeconds;
+    stats->framesCaptured = atomic_load(&framesCaptured);
+    stats->framesDropped = framesDropped;
+    stats->readbackSeconds = readbackSeconds;
+    stats->ticksPerFrame = governor.ticksPerFrame;
+    stats->grassSpawnScale = governor.grassSpawnScale;
+    stats->softCap = governor.softCap;
+    stats->governorAdjustments = governor.adjustments;
+    stats->birthsSuppressed = governor.birthsSuppressed;
+    stats->grassSuppressed = governor.grassSuppressed;
+    stats->reorders = reorderCount;
+    stats->orderDrift = orderDrift;
+    stats->tiles = shard != NULL ? shard->tileCount : 1;
+    stats->ghosts = ghostCount;
+    stats->migrations = migrationsIn;
+    stats->migrationsBlocked = migrationsBlocked;
+    stats->poolCapacity = creaturePool.capacity;
+    stats->poolUsed = creaturePool.capacity - creaturePool.freeCount;
+    stats->spawnsRefused = spawnsRefused;
+    // Allocation counters
+    static long long lastAllocs = 0, lastFrees = 0;
+    long long allocs = 0, frees = 0;
+    stats->creatureBytes = 0;
+    for (int i = 0; i < ALLOC_KIND_COUNT; i++)
+    {
+        stats->allocs[i] = allocStats.allocs[i];
+        stats->frees[i] = allocStats.frees[i];
+        stats->liveBytes[i] = allocStats.liveBytes[i];
+        stats->creatureBytes += allocStats.liveBytes[i];
+        allocs += allocStats.allocs[i];
+        frees += allocStats.frees[i];
+    }
+    stats->peakCreatureBytes = allocStats.peakLiveBytes;
+    stats->allocsLastTick = (int)(allocs - lastAllocs);
+    stats->freesLastTick = (int)(frees - lastFrees);
+    lastAllocs = allocs;
+    lastFrees = frees;
+
+    double now = NowSeconds();
+    if (rateStart == 0)
+    {
+        rateStart = now;
+        stats->residentBytes = ReadResidentBytes();
+        stats->peakResidentBytes = ReadPeakResidentBytes();
+    }
+    else if (now - rateStart >= 1.0)
+    {
+        float elapsed = (float)(now - rateStart);
+        stats->ticksPerSecond = (simTick - rateTick) / elapsed;
+        for (int i = 0; i < SPECIES_COUNT; i++)
+        {
+            stats->birthsPerSecond[i] = (birthTotals[i] - rateBirths[i]) / elapsed;
+            stats->deathsPerSecond[i] = (deathTotals[i] - rateDeaths[i]) / elapsed;
+            rateBirths[i] = birthTotals[i];
+            rateDeaths[i] = deathTotals[i];
+        }
+        stats->residentBytes = ReadResidentBytes();
+        stats->peakResidentBytes = ReadPeakResidentBytes();
+        // Never wait on the diversity thread; keep the previous results if it is publishing
+        if (pthread_mutex_trylock(&diversityResultsLock) == 0)
+        {
+            stats->diversity = diversityResults;
+            pthread_mutex_unlock(&diversityResultsLock);
+        }
+        rateStart = now;
+        rateTick = simTick;
+    }
+
+    WriteStats(stats);
+}
+
+// Software-rasterise a density heatmap of a creature snapshot (one pixel per CAPTURE_CELL world pixels)
+Image RasteriseHeatmap(const CaptureDot *dots, int count)
+{
+    int width = WINDOW_WIDTH / CAPTURE_CELL;
+    int height = WINDOW_HEIGHT / CAPTURE_CELL;
+    int *accum = (int *)calloc((size_t)width * height * 3, sizeof(int));
+    unsigned char *pixels = (unsigned char *)malloc((size_t)width * height * 4);
+
+    // Each creature adds a share of its color, so crowded cells saturate
+    for (int i = 0; i < count; i++)
+    {
+        int x = (int)(dots[i].position.x / CAPTURE_CELL);
+        int y = (int)(dots[i].position.y / CAPTURE_CELL);
+        if (x < 0 || y < 0 || x >= width || y >= height)
+            continue;
+        int *cell = accum + ((size_t)y * width + x) * 3;
+        cell[0] += dots[i].color.r / 2;
+        cell[1] += dots[i].color.g / 2;
+        cell[2] += dots[i].color.b / 2;
+    }
+    for (int i = 0; i < width * height; i++)
+    {
+        for (int c = 0; c < 3; c++)
+        {
+            int value = 16 + accum[i * 3 + c];
+            pixels[i * 4 + c] = value > 255 ? 255 : value;
+        }
+        pixels[i * 4 + 3] = 255;
+    }
+    free(accum);
+    return (Image){pixels, width, height, 1, PIXELFORMAT_UNCOMPRESSED_R8G8B8A8};
+}
+
+// Encode one frame: PNG into the capture directory, or raw RGBA into the encoder pipe
+void EncodeFrame(CaptureFrame *frame)
+{
+    Image image = frame->image;
+    if (frame->dots != NULL)
+    {
+        image = RasteriseHeatmap(frame->dots, frame->dotCount);
+        free(frame->dots);
+    }
+    else
+    {
+        ImageFlipVertical(&image); // Render textures are stored bottom-up
+    }
+
+    int written;
+    if (captureEncoder != NULL)
+    {
+        size_t bytes = (size_t)image.width * image.height * 4;
+        written = fwrite(image.data, 1, bytes, captureEncoder) == bytes;
+    }
+    else
+    {
+        char path[1024];
+        snprintf(path, sizeof(path), "%s/frame_%09lld.png", config.captureDir, frame->tick);
+        written = ExportImage(image, path);
+    }
+    if (written)
+        atomic_fetch_add(&framesCaptured, 1);
+
+    if (frame->dots != NULL)
+        free(image.data);
+    else
+        UnloadImage(image);
+}
+
+// Capture thread: encode queued frames until stopped and drained
+void *CaptureThreadMain(void *arg)
+{
+    for (;;)
+    {
+        pthread_mutex_lock(&captureLock);
+        while (captureLength == 0 && !captureStop)
+            pthread_cond_wait(&captureWake, &captureLock);
+        if (captureLength == 0)
+        {
+            pthread_mutex_unlock(&captureLock);
+            break;
+        }
+        CaptureFrame frame = captureQueue[captureHead];
+        captureHead = (captureHead + 1) % CAPTURE_QUEUE_SIZE;
+        captureLength--;
+        pthread_mutex_unlock(&captureLock);
+
+        EncodeFrame(&frame);
+    }
+    return NULL;
+}
+
+// Queue a frame for encoding; drops it instead of waiting when the queue is full
+int SubmitCaptureFrame(CaptureFrame frame)
+{
+    pthread_mutex_lock(&captureLock);
+    int accepted = captureLength < CAPTURE_QUEUE_SIZE;
+    if (accepted)
+    {
+        captureQueue[(captureHead + captureLength) % CAPTURE_QUEUE_SIZE] = frame;
+        captureLength++;
+        pthread_cond_signal(&captureWake);
+    }
+    pthread_mutex_unlock(&captureLock);
+
+    if (!accepted)
+    {
+        framesDropped++;
+        if (frame.dots != NULL)
+            free(frame.dots);
+        else
+            UnloadImage(frame.image);
+    }
+    return accepted;
+}
+
+// Whether the tick that just finished should be captured
+int CaptureDue()
+{
+    return captureStarted && simTick % config.captureEvery == 0;
+}
+
+// Queue a snapshot of creature positions for the headless heatmap
+void CaptureSnapshot()
+{
+    int count = LivingCreatures();
+
+    CaptureFrame frame = {simTick, {0}, NULL, 0};
+    frame.dots = (CaptureDot *)malloc((count > 0 ? count : 1) * sizeof(CaptureDot));
+    CreatureNode *current = creatureList;
+    while (current != NULL && frame.dotCount < count)
+    {
+        frame.dots[frame.dotCount++] = (CaptureDot){current->data->position, current->data->color};
+        current = current->next;
+    }
+    SubmitCaptureFrame(frame);
+}
+
+// Read back the capture render texture and queue it.
+// The readback itself is synchronous (raylib has no asynchronous pixel transfer), so it is timed
+// and published; only the encoding runs on the capture thread.
+void CaptureRenderTexture()
+{
+    double start = NowSeconds();
+    CaptureFrame frame = {simTick, LoadImageFromTexture(captureTarget.texture), NULL, 0};
+    readbackSeconds = NowSeconds() - start;
+    readbackTotalSeconds += readbackSeconds;
+    readbackCount++;
+    SubmitCaptureFrame(frame);
+}
+
+// Open the capture output and start the encoder thread
+int StartCapture()
+{
+    if (config.capturePipe != NULL)
+    {
+        captureEncoder = popen(config.capturePipe, "w");
+        if (captureEncoder == NULL)
+        {
+            fprintf(stderr, "Capture: cannot start encoder '%s': %s\n", config.capturePipe, strerror(errno));
+            return -1;
+        }
+        signal(SIGPIPE, SIG_IGN); // An encoder exiting early must not kill the simulation
+        int width = config.headless ? WINDOW_WIDTH / CAPTURE_CELL : WINDOW_WIDTH;
+        int height = config.headless ? WINDOW_HEIGHT / CAPTURE_CELL : WINDOW_HEIGHT;
+        printf("Capture: piping %dx%d RGBA frames every %d ticks to '%s'\n", width, height, config.captureEvery, config.capturePipe);
+    }
+    else
+    {
+        if (mkdir(config.captureDir, 0755) != 0 && errno != EEXIST)
+        {
+            fprintf(stderr, "Capture: cannot create %s: %s\n", config.captureDir, strerror(errno));
+            return -1;
+        }
+        printf("Capture: writing PNG frames every %d ticks to %s/\n", config.captureEvery, config.captureDir);
+    }
+
+    if (!config.headless)
+        captureTarget = LoadRenderTexture(WINDOW_WIDTH, WINDOW_HEIGHT);
+
+    captureStop = 0;
+    captureStarted = pthread_create(&captureThread, NULL, CaptureThreadMain, NULL) == 0;
+    return captureStarted ? 0 : -1;
+}
+
+// Flush queued frames and stop the encoder thread
+void StopCapture()
+{
+    if (!captureStarted)
+        return;
+    pthread_mutex_lock(&captureLock);
+    captureStop = 1;
+    pthread_cond_signal(&captureWake);
+    pthread_mutex_unlock(&captureLock);
+    pthread_join(captureThread, NULL);
+    captureStarted = 0;
+
+    if (captureEncoder != NULL)
+    {
+        pclose(captureEncoder);
+        captureEncoder = NULL;
+    }
+    if (!config.headless)
+    {
+        UnloadRenderTexture(captureTarget);
+        if (readbackCount > 0)
+            printf("Capture: %lld window frames read back, %.2f ms each on average (main thread)\n",
+                   readbackCount, readbackTotalSeconds * 1000.0 / readbackCount);
+    }
+}
+
+// Append formatted text to a fixed-size buffer, truncating when full
+void AppendText(char *buffer, size_t size, size_t *length, const char *format, ...)
+{
+    if (*length >= size)
+        return;
+    va_list args;
+    va_start(args, format);
+    int written = vsnprintf(buffer + *length, size - *length, format, args);
+    va_end(args);
+    if (written > 0)
+        *length = (*length + written < size) ? *length + written : size - 1;
+}
+
+// Render stats in the Prometheus text exposition format
+size_t FormatMetrics(const SimStats *stats, char *buffer, size_t size)
+{
+    size_t length = 0;
+
+    AppendText(buffer, size, &length, "# HELP evol_creatures Living creatures per species.\n# TYPE evol_creatures gauge\n");
+    for (int i = 0; i < SPECIES_COUNT; i++)
+        AppendText(buffer, size, &length, "evol_creatures{species=\"%s\"} %d\n", speciesTable[i].name, stats->counts[i]);
+
+    AppendText(buffer, size, &length, "# HELP evol_births_total Offspring born per species.\n# TYPE evol_births_total counter\n");
+    for (int i = 0; i < SPECIES_COUNT; i++)
+        AppendText(buffer, size, &length, "evol_births_total{species=\"%s\"} %lld\n", speciesTable[i].name, stats->births[i]);
+
+    AppendText(buffer, size, &length, "# HELP evol_deaths_total Creatures removed per species.\n# TYPE evol_deaths_total counter\n");
+    for (int i = 0; i < SPECIES_COUNT; i++)
+        AppendText(buffer, size, &length, "evol_deaths_total{species=\"%s\"} %lld\n", speciesTable[i].name, stats->deaths[i]);
+
+    AppendText(buffer, size, &length, "# HELP evol_births_per_second Birth rate over the last second.\n# TYPE evol_births_per_second gauge\n");
+    for (int i = 0; i < SPECIES_COUNT; i++)
+        AppendText(buffer, size, &length, "evol_births_per_second{species=\"%s\"} %.3f\n", speciesTable[i].name, stats->birthsPerSecond[i]);
+
+    AppendText(buffer, size, &length, "# HELP evol_deaths_per_second Death rate over the last second.\n# TYPE evol_deaths_per_second gauge\n");
+    for (int i = 0; i < SPECIES_COUNT; i++)
+        AppendText(buffer, size, &length, "evol_deaths_per_second{species=\"%s\"} %.3f\n", speciesTable[i].name, stats->deathsPerSecond[i]);
+
+    AppendText(buffer, size, &length, "# HELP evol_energy_mean Mean energy per species.\n# TYPE evol_energy_mean gauge\n");
+    for (int i = 0; i < SPECIES_COUNT; i++)
+        AppendText(buffer, size, &length, "evol_energy_mean{species=\"%s\"} %.3f\n", speciesTable[i].name, stats->energyMean[i]);
+    AppendText(buffer, size, &length, "# HELP evol_energy_variance Energy variance per species.\n# TYPE evol_energy_variance gauge\n");
+    for (int i = 0; i < SPECIES_COUNT; i++)
+        AppendText(buffer, size, &length, "evol_energy_variance{species=\"%s\"} %.3f\n", speciesTable[i].name, stats->energyVariance[i]);
+    AppendText(buffer, size, &length, "# HELP evol_age_mean Mean age in ticks per species.\n# TYPE evol_age_mean gauge\n");
+    for (int i = 0; i < SPECIES_COUNT; i++)
+        AppendText(buffer, size, &length, "evol_age_mean{species=\"%s\"} %.3f\n", speciesTable[i].name, stats->ageMean[i]);
+    AppendText(buffer, size, &length, "# HELP evol_age_variance Age variance per species.\n# TYPE evol_age_variance gauge\n");
+    for (int i = 0; i < SPECIES_COUNT; i++)
+        AppendText(buffer, size, &length, "evol_age_variance{species=\"%s\"} %.3f\n", speciesTable[i].name, stats->ageVariance[i]);
+    AppendText(buffer, size, &length, "# HELP evol_speed_mean Mean speed per species.\n# TYPE evol_speed_mean gauge\n");
+    for (int i = 0; i < SPECIES_COUNT; i++)
+        AppendText(buffer, size, &length, "evol_speed_mean{species=\"%s\"} %.3f\n", speciesTable[i].name, stats->speedMean[i]);
+    AppendText(buffer, size, &length, "# HELP evol_speed_variance Speed variance per species.\n# TYPE evol_speed_variance gauge\n");
+    for (int i = 0; i < SPECIES_COUNT; i++)
+        AppendText(buffer, size, &length, "evol_speed_variance{species=\"%s\"} %.6f\n", speciesTable[i].name, stats->speedVariance[i]);
+
+    AppendText(buffer, size, &length, "# HELP evol_brain_weight_variance Per-weight variance of sampled brains, averaged over weights.\n# TYPE evol_brain_weight_variance gauge\n");
+    for (int i = 0; i < GRASS; i++)
+        AppendText(buffer, size, &length, "evol_brain_weight_variance{species=\"%s\"} %.6f\n", speciesTable[i].name, stats->diversity.weightVariance[i]);
+    AppendText(buffer, size, &length, "# HELP evol_brain_pairwise_distance Mean distance between sampled brain pairs.\n# TYPE evol_brain_pairwise_distance gauge\n");
+    for (int i = 0; i < GRASS; i++)
+        AppendText(buffer, size, &length, "evol_brain_pairwise_distance{species=\"%s\"} %.6f\n", speciesTable[i].name, stats->diversity.pairwiseDistance[i]);
+    AppendText(buffer, size, &length, "# HELP evol_brain_samples Brains in the latest diversity sample.\n# TYPE evol_brain_samples gauge\n");
+    for (int i = 0; i < GRASS; i++)
+        AppendText(buffer, size, &length, "evol_brain_samples{species=\"%s\"} %d\n", speciesTable[i].name, stats->diversity.samples[i]);
+    AppendText(buffer, size, &length, "# HELP evol_brain_strategies Brain clusters (behavioural strategies) in the latest sample.\n# TYPE evol_brain_strategies gauge\n");
+    for (int i = 0; i < GRASS; i++)
+        AppendText(buffer, size, &length, "evol_brain_strategies{species=\"%s\"} %d\n", speciesTable[i].name, stats->diversity.strategies[i]);
+    AppendText(buffer, size, &length, "# HELP evol_brain_strategy_size Estimated creatures following each strategy, largest first.\n# TYPE evol_brain_strategy_size gauge\n");
+    for (int i = 0; i < GRASS; i++)
+    {
+        for (int m = 0; m < stats->diversity.strategies[i]; m++)
+            AppendText(buffer, size, &length, "evol_brain_strategy_size{species=\"%s\",strategy=\"%d\"} %d\n", speciesTable[i].name, m, stats->diversity.strategySizes[i][m]);
+    }
+
+    AppendText(buffer, size, &length, "# HELP evol_ticks_total Simulation ticks completed.\n# TYPE evol_ticks_total counter\nevol_ticks_total %lld\n", stats->tick);
+    AppendText(buffer, size, &length, "# HELP evol_ticks_per_second Tick rate over the last second.\n# TYPE evol_ticks_per_second gauge\nevol_ticks_per_second %.3f\n", stats->ticksPerSecond);
+
+    AppendText(buffer, size, &length, "# HELP evol_phase_seconds Time spent in each phase of the last tick.\n# TYPE evol_phase_seconds gauge\n");
+    AppendText(buffer, size, &length, "evol_phase_seconds{phase=\"update\"} %.9f\n", stats->updateSeconds);
+    AppendText(buffer, size, &length, "evol_phase_seconds{phase=\"think\"} %.9f\n", stats->thinkSeconds);
+    AppendText(buffer, size, &length, "evol_phase_seconds{phase=\"interact\"} %.9f\n", stats->interactSeconds);
+    AppendText(buffer, size, &length, "evol_phase_seconds{phase=\"draw\"} %.9f\n", stats->drawSeconds);
+
+    AppendText(buffer, size, &length, "# HELP evol_governor_ticks_per_frame Simulation ticks per rendered frame.\n# TYPE evol_governor_ticks_per_frame gauge\nevol_governor_ticks_per_frame %d\n", stats->ticksPerFrame);
+    AppendText(buffer, size, &length, "# HELP evol_governor_grass_spawn_scale Multiplier applied to the grass spawn rate.\n# TYPE evol_governor_grass_spawn_scale gauge\nevol_governor_grass_spawn_scale %.3f\n", stats->grassSpawnScale);
+    AppendText(buffer, size, &length, "# HELP evol_governor_soft_cap Soft population cap (0 = none).\n# TYPE evol_governor_soft_cap gauge\nevol_governor_soft_cap %d\n", stats->softCap);
+    AppendText(buffer, size, &length, "# HELP evol_governor_adjustments_total Governor adjustments.\n# TYPE evol_governor_adjustments_total counter\nevol_governor_adjustments_total %lld\n", stats->governorAdjustments);
+    AppendText(buffer, size, &length, "# HELP evol_births_suppressed_total Births withheld by the soft cap.\n# TYPE evol_births_suppressed_total counter\nevol_births_suppressed_total %lld\n", stats->birthsSuppressed);
+    AppendText(buffer, size, &length, "# HELP evol_grass_suppressed_total Grass spawns withheld by the governor.\n# TYPE evol_grass_suppressed_total counter\nevol_grass_suppressed_total %lld\n", stats->grassSuppressed);
+
+    AppendText(buffer, size, &length, "# HELP evol_reorders_total Morton reorders of creature storage.\n# TYPE evol_reorders_total counter\nevol_reorders_total %lld\n", stats->reorders);
+    AppendText(buffer, size, &length, "# HELP evol_order_drift Fraction of creatures out of Z-order relative to their list predecessor.\n# TYPE evol_order_drift gauge\nevol_order_drift %.4f\n", stats->orderDrift);
+
+    AppendText(buffer, size, &length, "# HELP evol_capture_frames_total Frames written by the capture thread.\n# TYPE evol_capture_frames_total counter\nevol_capture_frames_total %lld\n", stats->framesCaptured);
+    AppendText(buffer, size, &length, "# HELP evol_capture_dropped_total Frames dropped because the capture queue was full.\n# TYPE evol_capture_dropped_total counter\nevol_capture_dropped_total %lld\n", stats->framesDropped);
+    AppendText(buffer, size, &length, "# HELP evol_capture_readback_seconds GPU readback of the last captured window frame, on the main thread.\n# TYPE evol_capture_readback_seconds gauge\nevol_capture_readback_seconds %.6f\n", stats->readbackSeconds);
+
+    AppendText(buffer, size, &length, "# HELP evol_resident_memory_bytes Resident set size of the process (of all processes with --tiles).\n# TYPE evol_resident_memory_bytes gauge\nevol_resident_memory_bytes %lld\n", stats->residentBytes);
+    AppendText(buffer, size, &length, "# HELP evol_resident_memory_peak_bytes Peak resident set size of the process (highest total of all processes with --tiles).\n# TYPE evol_resident_memory_peak_bytes gauge\nevol_resident_memory_peak_bytes %lld\n", stats->peakResidentBytes);
+    AppendText(buffer, size, &length, "# HELP evol_creature_memory_bytes Bytes held by creatures, genomes and list nodes.\n# TYPE evol_creature_memory_bytes gauge\nevol_creature_memory_bytes %lld\n", stats->creatureBytes);
+    AppendText(buffer, size, &length, "# HELP evol_creature_memory_peak_bytes Peak bytes held by creatures, genomes and list nodes.\n# TYPE evol_creature_memory_peak_bytes gauge\nevol_creature_memory_peak_bytes %lld\n", stats->peakCreatureBytes);
+
+    AppendText(buffer, size, &length, "# HELP evol_allocations_total Allocations per object kind.\n# TYPE evol_allocations_total counter\n");
+    for (int i = 0; i < ALLOC_KIND_COUNT; i++)
+        AppendText(buffer, size, &length, "evol_allocations_total{kind=\"%s\"} %lld\n", allocKindNames[i], stats->allocs[i]);
+    AppendText(buffer, size, &length, "# HELP evol_frees_total Frees per object kind.\n# TYPE evol_frees_total counter\n");
+    for (int i = 0; i < ALLOC_KIND_COUNT; i++)
+        AppendText(buffer, size, &length, "evol_frees_total{kind=\"%s\"} %lld\n", allocKindNames[i], stats->frees[i]);
+    AppendText(buffer, size, &length, "# HELP evol_live_bytes Bytes currently allocated per object kind.\n# TYPE evol_live_bytes gauge\n");
+    for (int i = 0; i < ALLOC_KIND_COUNT; i++)
+        AppendText(buffer, size, &length, "evol_live_bytes{kind=\"%s\"} %lld\n", allocKindNames[i], stats->liveBytes[i]);
+    AppendText(buffer, size, &length, "# HELP evol_allocations_last_tick Allocations during the last tick.\n# TYPE evol_allocations_last_tick gauge\nevol_allocations_last_tick %d\n", stats->allocsLastTick);
+    AppendText(buffer, size, &length, "# HELP evol_frees_last_tick Frees during the last tick.\n# TYPE evol_frees_last_tick gauge\nevol_frees_last_tick %d\n", stats->freesLastTick);
+    AppendText(buffer, size, &length, "# HELP evol_pool_capacity Creature slots in the preallocated pool (0 = no pool).\n# TYPE evol_pool_capacity gauge\nevol_pool_capacity %d\n", stats->poolCapacity);
+    AppendText(buffer, size, &length, "# HELP evol_pool_used Creature slots in use.\n# TYPE evol_pool_used gauge\nevol_pool_used %d\n", stats->poolUsed);
+    AppendText(buffer, size, &length, "# HELP evol_spawns_refused_total Creatures not created because the pool was full.\n# TYPE evol_spawns_refused_total counter\nevol_spawns_refused_total %lld\n", stats->spawnsRefused);
+
+    AppendText(buffer, size, &length, "# HELP evol_tiles Tile processes sharing the world.\n# TYPE evol_tiles gauge\nevol_tiles %d\n", stats->tiles);
+    AppendText(buffer, size, &length, "# HELP evol_ghosts Creatures mirrored in from neighbouring tiles.\n# TYPE evol_ghosts gauge\nevol_ghosts %d\n", stats->ghosts);
+    AppendText(buffer, size, &length, "# HELP evol_migrations_total Creatures that crossed into another tile.\n# TYPE evol_migrations_total counter\nevol_migrations_total %lld\n", stats->migrations);
+    AppendText(buffer, size, &length, "# HELP evol_migrations_blocked_total Border crossings deferred because a migrant ring was full.\n# TYPE evol_migrations_blocked_total counter\nevol_migrations_blocked_total %lld\n", stats->migrationsBlocked);
+    return length;
+}
+
+// Answer one scrape: read the HTTP request, reply with the current metrics
+void ServeMetricsClient(int clientFd)
+{
+    char request[METRICS_REQUEST_SIZE];
+    size_t received = 0;
+    struct pollfd pfd = {clientFd, POLLIN, 0};
+
+    // Read until the end of the request headers (the request itself is not inspected)
+    while (received < sizeof(request) - 1 && poll(&pfd, 1, 1000) > 0)
+    {
+        ssize_t n = read(clientFd, request + received, sizeof(request) - 1 - received);
+        if (n <= 0)
+            break;
+        received += n;
+        request[received] = '\0';
+        if (strstr(request, "\r\n\r\n") != NULL || strstr(request, "\n\n") != NULL)
+            break;
+    }
+
+    SimStats stats;
+    ReadStats(&stats);
+
+    static char body[METRICS_RESPONSE_SIZE];
+    static char response[METRICS_RESPONSE_SIZE + 256];
+    size_t bodyLength = FormatMetrics(&stats, body, sizeof(body));
+    int headerLength = snprintf(response, sizeof(response),
+                                "HTTP/1.0 200 OK\r\n"
+                                "Content-Type: text/plain; version=0.0.4\r\n"
+                                "Content-Length: %zu\r\n"
+                                "Connection: close\r\n\r\n",
+                                bodyLength);
+    memcpy(response + headerLength, body, bodyLength);
+
+    size_t total = headerLength + bodyLength;
+    size_t sent = 0;
+    while (sent < total)
+    {
+        ssize_t n = write(clientFd, response + sent, total - sent);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            break;
+        sent += n;
+    }
+}
+
+// Metrics thread: accept scrapes until the server is stopped
+void *MetricsThreadMain(void *arg)
+{
+    struct pollfd pfd = {metricsListenFd, POLLIN, 0};
+    while (atomic_load(&metricsRunning))
+    {
+        // Wake up periodically to notice shutdown
+        if (poll(&pfd, 1, 250) <= 0)
+            continue;
+        int clientFd = accept(metricsListenFd, NULL, NULL);
+        if (clientFd < 0)
+            continue;
+        ServeMetricsClient(clientFd);
+        close(clientFd);
+    }
+    return NULL;
+}
+
+// Open the metrics listener and start its thread; the simulation keeps running if this fails
+int StartMetricsServer()
+{
+    if (config.metricsSocket != NULL)
+    {
+        struct sockaddr_un addr = {0};
+        addr.sun_family = AF_UNIX;
+        if (strlen(config.metricsSocket) >= sizeof(addr.sun_path))
+        {
+            fprintf(stderr, "Metrics socket path too long: %s\n", config.metricsSocket);
+            return -1;
+        }
+        strcpy(addr.sun_path, config.metricsSocket);
+        metricsListenFd = socket(AF_UNIX, SOCK_STREAM, 0);
+        unlink(config.metricsSocket); // Remove a stale socket from an earlier run
+        if (metricsListenFd < 0 || bind(metricsListenFd, (struct sockaddr *)&addr, sizeof(addr)) != 0)
+        {
+            fprintf(stderr, "Metrics: cannot bind %s: %s\n", config.metricsSocket, strerror(errno));
+            if (metricsListenFd >= 0)
+                close(metricsListenFd);
+            metricsListenFd = -1;
+            return -1;
+        }
+    }
+    else
+    {
+        struct sockaddr_in addr = {0};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(config.metricsPort);
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        metricsListenFd = socket(AF_INET, SOCK_STREAM, 0);
+        int reuse = 1;
+        if (metricsListenFd >= 0)
+            setsockopt(metricsListenFd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+        if (metricsListenFd < 0 || bind(metricsListenFd, (struct sockaddr *)&addr, sizeof(addr)) != 0)
+        {
+            fprintf(stderr, "Metrics: cannot bind 127.0.0.1:%d: %s\n", config.metricsPort, strerror(errno));
+            if (metricsListenFd >= 0)
+                close(metricsListenFd);
+            metricsListenFd = -1;
+            return -1;
+        }
+    }
+
+    if (listen(metricsListenFd, 8) != 0)
+    {
+        fprintf(stderr, "Metrics: listen failed: %s\n", strerror(errno));
+        close(metricsListenFd);
+        metricsListenFd = -1;
+        return -1;
+    }
+
+    // A scraper hanging up mid-response must not kill the simulation
+    signal(SIGPIPE, SIG_IGN);
+
+    atomic_store(&metricsRunning, 1);
+    if (pthread_create(&metricsThread, NULL, MetricsThreadMain, NULL) != 0)
+    {
+        atomic_store(&metricsRunning, 0);
+        close(metricsListenFd);
+        metricsListenFd = -1;
+        return -1;
+    }
+    if (config.metricsSocket != NULL)
+        printf("Metrics: serving on unix:%s\n", config.metricsSocket);
+    else
+        printf("Metrics: serving on http://127.0.0.1:%d/metrics\n", config.metricsPort);
+    return 0;
+}
+
+// Stop the metrics thread and release the listener
+void StopMetricsServer()
+{
+    if (!atomic_load(&metricsRunning))
+        return;
+    atomic_store(&metricsRunning, 0);
+    pthread_join(metricsThread, NULL);
+    close(metricsListenFd);
+    metricsListenFd = -1;
+    if (config.metricsSocket != NULL)
+        unlink(config.metricsSocket);
+}
+
+// Record a governor change so it shows up in the stats, and in the log at most once per GOVERNOR_LOG_INTERVAL
+void ReportGovernorAdjustment(const char *reason)
+{
+    static double lastLog = 0;
+    static int unlogged = 0;
+    governor.adjustments++;
+    governor.framesSinceAdjustment = 0;
+    double now = NowSeconds();
+    if (now - lastLog < GOVERNOR_LOG_INTERVAL)
+    {
+        unlogged++;
+        return;
+    }
+    printf("Governor: %s (ticks/frame %d, grass x%.2f, soft cap %d)", reason,
+           governor.ticksPerFrame, governor.grassSpawnScale, governor.softCap);
+    if (unlogged > 0)
+        printf(", %d earlier changes not logged", unlogged);
+    printf("\n");
+    lastLog = now;
+    unlogged = 0;
+}
+
+// Adjust ticks per frame and the population throttles to hold the frame budget
+void UpdateGovernor(double tickSeconds, int ticks, double drawSeconds)
+{
+    if (config.frameBudgetMs <= 0 || ticks <= 0)
+        return;
+    double budget = config.frameBudgetMs / 1000.0;
+    double perTick = tickSeconds / ticks;
+    governor.tickCost = governor.tickCost == 0 ? perTick : governor.tickCost * 0.8 + perTick * 0.2;
+    governor.drawCost = governor.drawCost == 0 ? drawSeconds : governor.drawCost * 0.8 + drawSeconds * 0.2;
+    if (++governor.framesSinceAdjustment < GOVERNOR_INTERVAL)
+        return;
+
+    double predicted = governor.ticksPerFrame * governor.tickCost + governor.drawCost;
+    int throttled = governor.grassSpawnScale < 1.0f || governor.softCap > 0;
+    int living = LivingCreatures();
+    if (predicted > budget)
+    {
+        if (governor.ticksPerFrame > 1)
+        {
+            governor.ticksPerFrame--;
+            ReportGovernorAdjustment("over budget, fewer ticks per frame");
+        }
+        else
+        {
+            // Already at one tick per frame: slow population growth instead (unless fully throttled)
+            float grassSpawnScale = fmaxf(MIN_GRASS_SPAWN_SCALE, governor.grassSpawnScale * 0.8f);
+            int softCap = governor.softCap;
+            if (softCap == 0 || softCap > living)
+                softCap = living > 1 ? living : 1;
+            if (grassSpawnScale != governor.grassSpawnScale || softCap != governor.softCap)
+            {
+                governor.grassSpawnScale = grassSpawnScale;
+                governor.softCap = softCap;
+                ReportGovernorAdjustment("over budget, throttling growth");
+            }
+        }
+    }
+    else if (predicted + governor.tickCost < budget * 0.8)
+    {
+        if (throttled)
+        {
+            // Lift throttles before speeding up
+            governor.grassSpawnScale = fminf(1.0f, governor.grassSpawnScale * 1.25f);
+            if (governor.softCap > 0)
+                governor.softCap = governor.softCap + governor.softCap / 10 + 1;
+            if (governor.grassSpawnScale >= 1.0f && governor.softCap > 2 * living)
+                governor.softCap = 0;
+            ReportGovernorAdjustment("under budget, relaxing throttles");
+        }
+        else if (governor.ticksPerFrame < MAX_TICKS_PER_FRAME)
+        {
+            governor.ticksPerFrame++;
+            ReportGovernorAdjustment("under budget, more ticks per frame");
+        }
+    }
+}
+
+// Free what is left of the simulation and count the tracked allocations that were not freed, per kind
+void CountLeaks(long long allocs[ALLOC_KIND_COUNT], long long bytes[ALLOC_KIND_COUNT])
+{
+    FreeAllCreatures();
+    for (int i = 0; i < ALLOC_KIND_COUNT; i++)
+    {
+        allocs[i] = allocStats.allocs[i] - allocStats.frees[i];
+        bytes[i] = allocStats.liveBytes[i];
+    }
+}
+
+// Print the leaked allocations per kind, or that there were none
+void PrintLeaks(const long long allocs[ALLOC_KIND_COUNT], const long long bytes[ALLOC_KIND_COUNT])
+{
+    int leaks = 0;
+    for (int i = 0; i < ALLOC_KIND_COUNT; i++)
+    {
+        if (allocs[i] != 0 || bytes[i] != 0)
+        {
+            printf("Leak: %lld %s allocations (%lld bytes) never freed\n", allocs[i], allocKindNames[i], bytes[i]);
+            leaks++;
+        }
+    }
+    if (leaks == 0)
+        printf("Leak check: all tracked allocations freed\n");
+}
+
+// Free what is left of the simulation and report any tracked allocation that was not freed
+void ReportLeaks()
+{
+    long long allocs[ALLOC_KIND_COUNT], bytes[ALLOC_KIND_COUNT];
+    CountLeaks(allocs, bytes);
+    PrintLeaks(allocs, bytes);
+}
+
+// Print command line usage
+void PrintUsage(const char *program)
+{
+    printf("Usage: %s [options]\n", program);
+    printf("  --headless              Run without a window\n");
+    printf("  --ticks N               Stop after N ticks (headless, default: until interrupted)\n");
+    printf("  --metrics-port PORT     Serve Prometheus metrics on 127.0.0.1:PORT\n");
+    printf("  --metrics-socket PATH   Serve Prometheus metrics on a Unix domain socket\n");
+    printf("  --capture-every N       Capture a frame every N ticks (heatmap when headless)\n");
+    printf("  --capture-dir DIR       Directory for the PNG frame sequence (default: capture)\n");
+    printf("  --capture-pipe CMD      Pipe raw RGBA frames to an encoder command instead of PNGs\n");
+    printf("  --frame-budget MS       Interactive frame budget held by the governor (default: %.0f, 0 = off)\n", DEFAULT_FRAME_BUDGET_MS);
+    printf("  --threads N             Threads for parallel phases (default: one per CPU)\n");
+    printf("  --hidden W[,W...]       Hidden layer widths (default: %d, up to %d layers of %d)\n", HIDDEN, MAX_LAYERS - 2, MAX_LAYER_WIDTH);
+    printf("  --tiles CxR             Split a headless world into CxR tiles, one process each (up to %dx%d)\n", MAX_TILE_AXIS, MAX_TILE_AXIS);
+    printf("  --pool N                Preallocate N creatures at startup and refuse spawns beyond them (per tile)\n");
+    printf("  --hugepages             Back the --pool memory with transparent huge pages\n");
+    printf("  --seed N                Random seed, for reproducible runs (default: the start time)\n");
+}
+
+// Parse command line options into config; returns 0 on invalid input
+int ParseArguments(int argc, char **argv)
+{
+    config.frameBudgetMs = DEFAULT_FRAME_BUDGET_MS;
+    config.tilesX = 1;
+    config.tilesY = 1;
+    config.seed = (unsigned int)time(NULL);
+    int hidden[MAX_LAYERS] = {HIDDEN};
+    int hiddenCount = 1;
+    for (int i = 1; i < argc; i++)
+    {
+        const char *arg = argv[i];
+        const char *value = (i + 1 < argc) ? argv[i + 1] : NULL;
+        if (strcmp(arg, "--headless") == 0)
+        {
+            config.headless = 1;
+        }
+        else if (strcmp(arg, "--ticks") == 0 && value != NULL)
+        {
+            config.maxTicks = atoll(value);
+            i++;
+        }
+        else if (strcmp(arg, "--metrics-port") == 0 && value != NULL)
+        {
+            config.metricsPort = atoi(value);
+            i++;
+        }
+        else if (strcmp(arg, "--metrics-socket") == 0 && value != NULL)
+        {
+            config.metricsSocket = value;
+            i++;
+        }
+        else if (strcmp(arg, "--frame-budget") == 0 && value != NULL)
+        {
+            config.frameBudgetMs = atof(value);
+            i++;
+        }
+        else if (strcmp(arg, "--threads") == 0 && value != NULL)
+        {
+            config.threads = atoi(value);
+            i++;
+        }
+        else if (strcmp(arg, "--capture-every") == 0 && value != NULL)
+        {
+            config.captureEvery = atoi(value);
+            i++;
+        }
+        else if (strcmp(arg, "--capture-dir") == 0 && value != NULL)
+        {
+            config.captureDir = value;
+            i++;
+        }
+        else if (strcmp(arg, "--capture-pipe") == 0 && value != NULL)
+        {
+            config.capturePipe = value;
+            i++;
+        }
+        else if (strcmp(arg, "--tiles") == 0 && value != NULL)
+        {
+            char separator = 0;
+            if (sscanf(value, "%d%c%d", &config.tilesX, &separator, &config.tilesY) != 3 || separator != 'x')
+                config.tilesX = 0; // Rejected below
+            config.headless = 1; // Tiles only run headless
+            i++;
+        }
+        else if (strcmp(arg, "--pool") == 0 && value != NULL)
+        {
+            config.poolSize = atoi(value);
+            i++;
+        }
+        else if (strcmp(arg, "--hugepages") == 0)
+        {
+            config.hugePages = 1;
+        }
+        else if (strcmp(arg, "--seed") == 0 && value != NULL)
+        {
+            config.seed = (unsigned int)strtoul(value, NULL, 10);
+            i++;
+        }
+        else if (strcmp(arg, "--hidden") == 0 && value != NULL)
+        {
+            // Comma separated widths; "0" means no hidden layer
+            hiddenCount = 0;
+            for (const char *p = value; *p != '\0' && hiddenCount < MAX_LAYERS; hiddenCount++)
+            {
+                char *end;
+                hidden[hiddenCount] = (int)strtol(p, &end, 10);
+                if (end == p || (*end != ',' && *end != '\0'))
+                {
+                    hiddenCount = -1; // Rejected by SetupTopology
+                    break;
+                }
+                p = (*end == ',') ? end + 1 : end;
+            }
+            if (hiddenCount == 1 && hidden[0] == 0)
+                hiddenCount = 0;
+            i++;
+        }
+        else
+        {
+            PrintUsage(argv[0]);
+            return 0;
+        }
+    }
+    if (config.captureDir == NULL)
+        config.captureDir = "capture";
+    if (config.metricsPort < 0 || config.metricsPort > 65535 || config.maxTicks < 0 || config.captureEvery < 0 || config.threads < 0 || config.frameBudgetMs < 0 || config.poolSize < 0)
+    {
+        PrintUsage(argv[0]);
+        return 0;
+    }
+    if (config.tilesX < 1 || config.tilesX > MAX_TILE_AXIS || config.tilesY < 1 || config.tilesY > MAX_TILE_AXIS)
+    {
+        fprintf(stderr, "Unsupported tile layout\n");
+        PrintUsage(argv[0]);
+        return 0;
+    }
+    if (config.tilesX * config.tilesY > 1 && config.captureEvery > 0)
+    {
+        fprintf(stderr, "Capture is not supported with --tiles\n");
+        return 0;
+    }
+    if (config.hugePages && config.poolSize == 0)
+    {
+        fprintf(stderr, "--hugepages needs --pool\n");
+        return 0;
+    }
+    if (!SetupTopology(hidden, hiddenCount))
+    {
+        fprintf(stderr, "Unsupported network topology\n");
+        PrintUsage(argv[0]);
+        return 0;
+    }
+    return 1;
+}
+
+// Stop a headless run cleanly on Ctrl+C
+void HandleStopSignal(int signum)
+{
+    keepRunning = 0;
+}
+
+// Print a summary of a finished headless run
+void PrintSummary(const SimStats *stats, double elapsed)
+{
+    printf("Ticks: %lld in %.1fs (%.1f ticks/s)\n", stats->tick, elapsed, elapsed > 0 ? stats->tick / elapsed : 0.0);
+    printf("Rabbits: %d, Ducks: %d, Foxes: %d, Wolves: %d, Grass: %d\n",
+           stats->counts[RABBIT], stats->counts[DUCK], stats->counts[FOX], stats->counts[WOLF], stats->counts[GRASS]);
+    printf("Births: %lld rabbits, %lld ducks, %lld foxes, %lld wolves\n",
+           stats->births[RABBIT], stats->births[DUCK], stats->births[FOX], stats->births[WOLF]);
+    printf("Storage: %lld Morton reorders, drift %.2f at last check\n", stats->reorders, stats->orderDrift);
+    for (int i = 0; i < GRASS; i++)
+    {
+        if (stats->diversity.strategies[i] < 2)
+            continue;
+        printf("Strategies: %s %d (", speciesTable[i].label, stats->diversity.strategies[i]);
+        for (int m = 0; m < stats->diversity.strategies[i]; m++)
+            printf(m > 0 ? ", %d" : "%d", stats->diversity.strategySizes[i][m]);
+        printf(")\n");
+    }
+    if (stats->tiles > 1)
+        printf("Tiles: %d, %lld migrations (%lld deferred), %d ghosts at the end\n", stats->tiles, stats->migrations, stats->migrationsBlocked, stats->ghosts);
+    if (config.captureEvery > 0)
+        printf("Capture: %lld frames written, %lld dropped\n", stats->framesCaptured, stats->framesDropped);
+    printf("Memory: %.1f MB resident (peak %.1f MB), %.1f KB in creatures (peak %.1f KB)\n",
+           stats->residentBytes / 1048576.0, stats->peakResidentBytes / 1048576.0,
+           stats->creatureBytes / 1024.0, stats->peakCreatureBytes / 1024.0);
+    for (int i = 0; i < ALLOC_KIND_COUNT; i++)
+    {
+        printf("  %-8s %12lld allocs %12lld frees %10.1f KB live\n", allocKindNames[i],
+               stats->allocs[i], stats->frees[i], stats->liveBytes[i] / 1024.0);
+    }
+    if (stats->poolCapacity > 0)
+        printf("Pool: %d of %d creature slots in use, %lld spawns refused\n", stats->poolUsed, stats->poolCapacity, stats->spawnsRefused);
+}
+
+// Append a record to a shard ring; returns 0 if the ring is full
+int RingPush(ShardRing *ring, const void *header, size_t headerSize, const void *body, size_t bodySize)
+{
+    unsigned int tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    unsigned int head = atomic_load_explicit(&ring->head, memory_order_acquire);
+    if (tail - head >= ring->capacity)
+        return 0;
+    unsigned char *record = ring->records + (size_t)(tail % ring->capacity) * ring->recordSize;
+    memcpy(record, header, headerSize);
+    if (bodySize > 0)
+        memcpy(record + headerSize, body, bodySize);
+    atomic_store_explicit(&ring->tail, tail + 1, memory_order_release);
+    return 1;
+}
 
-        // Initialize the neural network "brain"
-        newCreature->brain = (NeuralNetwork){0};
-        InitializeNetwork(&newCreature->brain);
+// Oldest unread record of a shard ring, or NULL if it is empty (RingPop() releases it)
+const unsigned char *RingPeek(ShardRing *ring)
+{
+    unsigned int head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    unsigned int tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+    if (head == tail)
+        return NULL;
+    return ring->records + (size_t)(head % ring->capacity) * ring->recordSize;
+}
 
-        // Set color based on species type for visual identification
-        newCreature->color = (newCreature->type == RABBIT) ? GREEN : (newCreature->type == DUCK) ? BLUE
-                                                                 : (newCreature->type == FOX)    ? ORANGE
-                                                                                                 : RED;
-        AddCreature(newCreature);
-    }
+void RingPop(ShardRing *ring)
+{
+    unsigned int head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    atomic_store_explicit(&ring->head, head + 1, memory_order_release);
 }
 
-// Count the number of creatures in the linked list (debugging function)
-void SizeOfCreatures()
+// Whether the other processes of the shard are still running
+int ShardPeersAlive()
 {
-    CreatureNode *current = creatureList;
-    int size = 0;
-    while (current != NULL)
-    {
-        size++;
-        current = current->next;
-    }
+    if (getpid() == coordinatorPid)
+        return waitpid(-1, NULL, WNOHANG) <= 0; // A tile exiting mid-run is a failure
+    return getppid() == coordinatorPid;
 }
 
-// Remove a creature from the simulation and free its memory
-void DestroyCreature(Creature *creature)
+// Sleep until the barrier generation moves on from `generation`, or for at most a few milliseconds
+void ShardSleep(unsigned int generation)
 {
-    // Remove creature from linked list
-    CreatureNode *current = creatureList;
-    CreatureNode *prev = NULL;
+#ifdef __linux__
+    // Shared (not private) futex: the waiters are separate processes
+    struct timespec timeout = {0, 20 * 1000000L};
+    syscall(SYS_futex, (unsigned int *)&shard->generation, FUTEX_WAIT, generation, &timeout, NULL, 0);
+#else
+    (void)generation;
+    struct timespec pause = {0, 100 * 1000L};
+    nanosleep(&pause, NULL);
+#endif
+}
 
-    SizeOfCreatures();
-    while (current != NULL)
+// Wake every process sleeping in ShardSleep()
+void ShardWake()
+{
+#ifdef __linux__
+    syscall(SYS_futex, (unsigned int *)&shard->generation, FUTEX_WAKE, shard->parties, NULL, NULL, 0);
+#endif
+}
+
+// Abort the run and release everyone waiting at the barrier
+void ShardAbort()
+{
+    atomic_store(&shard->abort, 1);
+    ShardWake();
+}
+
+// Wait until every tile and the coordinator arrive; returns 0 if the run was aborted
+int ShardBarrier()
+{
+    unsigned int generation = atomic_load(&shard->generation);
+    if (atomic_fetch_add(&shard->arrived, 1) == (unsigned int)shard->parties - 1)
+    {
+        atomic_store(&shard->arrived, 0);
+        atomic_fetch_add(&shard->generation, 1);
+        ShardWake();
+    }
+    else
     {
-        if (current->data == creature)
+        // Spin briefly (the slowest tile is often only moments behind), then sleep
+        for (int spins = 0; atomic_load(&shard->generation) == generation; spins++)
         {
-            // Handle removal at the head of the list
-            if (prev == NULL)
-            {
-                creatureList = current->next;
-            }
-            else
+            if (atomic_load(&shard->abort))
+                return 0;
+            if (spins < 64)
+                continue;
+            ShardSleep(generation);
+            if (atomic_load(&shard->generation) == generation && !ShardPeersAlive())
             {
-                prev->next = current->next;
+                ShardAbort();
+                return 0;
             }
-            CreatureNode *temp = current;
-            current = current->next;
-            free(temp->data); // Free creature data
-            free(temp);       // Free node itself
-            return;
         }
-        prev = current;
-        current = current->next;
     }
-    SizeOfCreatures();
+    return !atomic_load(&shard->abort);
 }
 
-// Check for interactions between creatures (eating, reproduction)
-void CheckInteractions(Creature *current)
+// Map the shared region and lay out every tile's rings; returns 0 on failure
+int MapShard(int tileCount)
 {
-    CreatureNode *other = creatureList;
-    while (other != NULL)
+    size_t migrantSize = sizeof(Creature) + topology.genomeLength * sizeof(float);
+    size_t ringBytes = TILE_SIDES * (GHOST_RING_SIZE * sizeof(GhostRecord) + MIGRANT_RING_SIZE * migrantSize);
+    shardBytes = sizeof(ShardShared) + (size_t)tileCount * ringBytes;
+    void *region = mmap(NULL, shardBytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (region == MAP_FAILED)
     {
-        if (current != other->data && other->data->energy > 0)
+        fprintf(stderr, "Shard: cannot map %zu bytes: %s\n", shardBytes, strerror(errno));
+        return 0;
+    }
+    shard = (ShardShared *)region; // Anonymous mappings start zeroed
+    shard->tileCount = tileCount;
+    shard->parties = tileCount + 1;
+    unsigned char *records = (unsigned char *)region + sizeof(ShardShared);
+    for (int t = 0; t < tileCount; t++)
+    {
+        for (int side = 0; side < TILE_SIDES; side++)
         {
-            // Calculate distance between creatures
-            float distance = sqrtf(powf(current->position.x - other->data->position.x, 2) +
-                                   powf(current->position.y - other->data->position.y, 2));
-
-            // Interaction occurs when creatures are close enough
-            if (distance < 24)
-            {
-                // Fox eats rabbits and ducks
-                if (current->type == FOX && (other->data->type == DUCK || other->data->type == RABBIT))
-                {
-                    current->energy += other->data->energy;
-                    other->data->energy = -1; // Mark for removal
-                }
-                // Wolf eats rabbits, ducks, and foxes
-                else if (current->type == WOLF && (other->data->type == DUCK || other->data->type == RABBIT || other->data->type == FOX))
-                {
-                    current->energy += other->data->energy;
-                    other->data->energy = -1; // Mark for removal
-                }
-                // Duck eats grass
-                else if (current->type == DUCK && other->data->type == GRASS)
-                {
-                    current->energy += other->data->energy;
-                    other->data->energy = -1; // Mark for removal
-                }
-                // Rabbit eats grass
-                else if (current->type == RABBIT && other->data->type == GRASS)
-                {
-                    current->energy += other->data->energy;
-                    other->data->energy = -1; // Mark for removal
-                }
-                // Reproduction between same species if they have enough energy
-                else if (current->type == other->data->type &&
-                         CanReproduce(current) &&
-                         CanReproduce(other->data) &&
-                         current->type != GRASS)
-                {
-                    // 70% chance to reproduce when conditions are met
-                    if ((float)rand() / RAND_MAX < 0.7f)
-                    {
-                        // Create offspring with traits from both parents
-                        Creature *offspring = (Creature *)malloc(sizeof(Creature));
-                        offspring->type = current->type;
-                        offspring->speed = current->speed;
-                        offspring->color = current->color;
-
-                        // Mix neural networks from both parents
-                        for (int i = 0; i < HIDDEN; i++)
-                        {
-                            for (int j = 0; j < INPUTS; j++)
-                            {
-                                // 50% chance to inherit from each parent
-                                offspring->brain.weightsIH[i][j] = MutateValue(
-                                    (rand() % 2) ? current->brain.weightsIH[i][j] : other->data->brain.weightsIH[i][j],
-                                    MUTATION_CHANCE);
-                            }
-                            offspring->brain.biasH[i] = MutateValue(
-                                (rand() % 2) ? current->brain.biasH[i] : other->data->brain.biasH[i],
-                                MUTATION_CHANCE);
-                        }
-
-                        for (int i = 0; i < OUTPUTS; i++)
-                        {
-                            for (int j = 0; j < HIDDEN; j++)
-                            {
-                                // CORRECT: Using weightsHO to copy hidden-to-output weights
-                                offspring->brain.weightsHO[i][j] = MutateValue(
-                                    (rand() % 2) ? current->brain.weightsHO[i][j] : other->data->brain.weightsHO[i][j],
-                                    MUTATION_CHANCE);
-                            }
-                            // CORRECT: Using biasO for output layer biases
-                            offspring->brain.biasO[i] = MutateValue(
-                                (rand() % 2) ? current->brain.biasO[i] : other->data->brain.biasO[i],
-                                MUTATION_CHANCE);
-                        }
-
-                        // Position offspring near parents with slight randomness
-                        offspring->position = (Vector2){
-                            current->position.x + ((float)rand() / RAND_MAX * 40 - 20),
-                            current->position.y + ((float)rand() / RAND_MAX * 40 - 20)};
-
-                        // Transfer energy from parents to offspring
-                        float parentEnergy1 = current->energy / 3;
-                        float parentEnergy2 = other->data->energy / 3;
+            ShardRing *ring = &shard->tiles[t].ghosts[side];
+            ring->capacity = GHOST_RING_SIZE;
+            ring->recordSize = sizeof(GhostRecord);
+            ring->records = records;
+            records += GHOST_RING_SIZE * sizeof(GhostRecord);
 
-                        if (isnan(parentEnergy1) || isnan(parentEnergy2))
-                        {
-                            parentEnergy1 = fmaxf(0, current->energy / 3);
-                            parentEnergy2 = fmaxf(0, other->data->energy / 3);
-                        }
-
-                        offspring->energy = parentEnergy1 + parentEnergy2;
-                        current->energy = current->energy * 2 / 3;
-                        other->data->energy = other->data->energy * 2 / 3;
-                        offspring->age = 0;
-                        offspring->last_mate = 0;
-                        // Add offspring to the simulation
-                        AddCreature(offspring);
-                        // Add hearth effect
-                        for (size_t i = 0; i < MAX_HEARTH_EFFECTS; i++)
-                        {
-                            if (hearthEffects[i].age == 0 && hearthEffects[i].position.x == 0 && hearthEffects[i].position.y == 0)
-                            {
-                                hearthEffects[i].age = 1;
-                                hearthEffects[i].position = offspring->position;
-                                break;
-                            }
-                        }
-                    }
-                }
-            }
+            ring = &shard->tiles[t].migrants[side];
+            ring->capacity = MIGRANT_RING_SIZE;
+            ring->recordSize = migrantSize;
+            ring->records = records;
+            records += MIGRANT_RING_SIZE * migrantSize;
         }
-        other = other->next;
     }
+    return 1;
 }
 
-// Process neural network inputs to determine creature movement and actions
-void ProcessNeuralNetwork(Creature *c, float inputs[INPUTS])
+// Side of the tile a creature has left through, or -1 if it is still inside
+int ExitSide(const Creature *c)
 {
-    // Initialize and validate inputs
-    for (int i = 0; i < INPUTS; i++)
-    {
-        inputs[i] = 0.0f;
-    }
-
-    // Basic environmental inputs
-    inputs[0] = c->position.x / WINDOW_WIDTH;  // Normalized x position
-    inputs[1] = c->position.y / WINDOW_HEIGHT; // Normalized y position
-    inputs[2] = c->energy / 1000.0f;           // Normalized energy level
-    // Replace age with boundary proximity (how close to edge of simulation)
-    float distToLeftBoundary = c->position.x;
-    float distToRightBoundary = WINDOW_WIDTH - c->position.x;
-    float distToTopBoundary = c->position.y;
-    float distToBottomBoundary = WINDOW_HEIGHT - c->position.y;
-    float closestBoundaryDist = fminf(fminf(distToLeftBoundary, distToRightBoundary),
-                                      fminf(distToTopBoundary, distToBottomBoundary));
-    inputs[3] = fminf(1.0f, closestBoundaryDist / 100.0f); // Normalized boundary proximity
+    if (c->position.x < 0 && tileNeighbours[TILE_LEFT] >= 0)
+        return TILE_LEFT;
+    if (c->position.x >= WINDOW_WIDTH && tileNeighbours[TILE_RIGHT] >= 0)
+        return TILE_RIGHT;
+    if (c->position.y < 0 && tileNeighbours[TILE_UP] >= 0)
+        return TILE_UP;
+    if (c->position.y >= WINDOW_HEIGHT && tileNeighbours[TILE_DOWN] >= 0)
+        return TILE_DOWN;
+    return -1;
+}
 
-    // Initialize tracking variables
-    float nearestFoodDist = INFINITY;
-    float nearestPredatorDist = INFINITY;
-    float nearestMateDist = INFINITY;
-    Vector2 foodDir = {0, 0};
-    Vector2 predatorDir = {0, 0};
-    Vector2 mateDir = {0, 0};
+// Position in the coordinates of the neighbour on the given side
+Vector2 AcrossBorder(Vector2 position, int side)
+{
+    static const Vector2 shift[TILE_SIDES] = {{WINDOW_WIDTH, 0}, {-WINDOW_WIDTH, 0}, {0, WINDOW_HEIGHT}, {0, -WINDOW_HEIGHT}};
+    return (Vector2){position.x + shift[side].x, position.y + shift[side].y};
+}
 
-    // Scan surroundings with improved range detection
-    const float MAX_DETECTION_RANGE = 1000.0f; // Maximum detection range
-    CreatureNode *other = creatureList;
-    while (other != NULL)
+// Hand creatures that crossed into a neighbouring tile over to it, genome included
+void SendMigrants()
+{
+    size_t genomeBytes = topology.genomeLength * sizeof(float);
+    CreatureNode **link = &creatureList;
+    while (*link != NULL)
     {
-        if (other->data != c && other->data->energy > 0)
+        CreatureNode *node = *link;
+        Creature *c = node->data;
+        int side = ExitSide(c);
+        if (side < 0)
+        {
+            link = &node->next;
+            continue;
+        }
+        Creature migrant = *c;
+        migrant.position = AcrossBorder(c->position, side);
+        if (!RingPush(&shard->tiles[tileIndex].migrants[side], &migrant, sizeof(Creature), c->brain.genes, genomeBytes))
         {
-            float dist = sqrtf(powf(c->position.x - other->data->position.x, 2) +
-                               powf(c->position.y - other->data->position.y, 2));
+            migrationsBlocked++; // Stays here and tries again next tick
+            link = &node->next;
+            continue;
+        }
+        // Leaves this tile without counting as a death
+        *link = node->next;
+        TrackCreature(c, -1);
+        FreeCreatureNode(node);
+    }
+}
 
-            if (dist <= MAX_DETECTION_RANGE)
+// Adopt the creatures the neighbours sent across their borders
+void ReceiveMigrants()
+{
+    size_t genomeBytes = topology.genomeLength * sizeof(float);
+    for (int side = 0; side < TILE_SIDES; side++)
+    {
+        int neighbour = tileNeighbours[side];
+        if (neighbour < 0)
+            continue;
+        ShardRing *ring = &shard->tiles[neighbour].migrants[side ^ 1]; // Their outbox facing us
+        const unsigned char *record;
+        while ((record = RingPeek(ring)) != NULL)
+        {
+            // Pool full: the migrant waits in the ring and counts as one refused spawn however long it waits
+            if (poolMapping != NULL && creaturePool.freeCount == 0)
             {
-                Vector2 direction = {
-                    other->data->position.x - c->position.x,
-                    other->data->position.y - c->position.y};
-
-                // Food detection with species-specific logic
-                if (((c->type == RABBIT || c->type == DUCK) && other->data->type == GRASS) ||
-                    (c->type == FOX && (other->data->type == RABBIT || other->data->type == DUCK)) ||
-                    (c->type == WOLF && (other->data->type == RABBIT || other->data->type == DUCK || other->data->type == FOX)))
-                {
-                    if (dist < nearestFoodDist)
-                    {
-                        nearestFoodDist = dist;
-                        foodDir = direction;
-                    }
-                }
-
-                // Predator detection
-                if (((c->type == RABBIT || c->type == DUCK) && (other->data->type == FOX || other->data->type == WOLF)) ||
-                    (c->type == FOX && other->data->type == WOLF))
-                {
-                    if (dist < nearestPredatorDist)
-                    {
-                        nearestPredatorDist = dist;
-                        predatorDir = direction;
-                    }
-                }
-
-                // Mate detection (same species and suitable for reproduction)
-                if (other->data->type == c->type && CanReproduce(other->data))
+                unsigned int position = atomic_load_explicit(&ring->head, memory_order_relaxed) + 1;
+                if (refusedMigrant[side] != position)
                 {
-                    if (dist < nearestMateDist)
-                    {
-                        nearestMateDist = dist;
-                        mateDir = direction;
-                    }
+                    refusedMigrant[side] = position;
+                    spawnsRefused++;
                 }
+                break;
             }
+            Creature *c = AllocCreature(CreatureAllocKind(((const Creature *)record)->type));
+            if (c == NULL)
+                break; // Out of memory: the migrant waits in the ring
+            memcpy(c, record, sizeof(Creature));
+            AllocateNetwork(&c->brain);
+            memcpy(c->brain.genes, record + sizeof(Creature), genomeBytes);
+            RingPop(ring);
+            AddCreature(c);
+            migrationsIn++;
         }
-        other = other->next;
     }
+}
 
-    // Normalize and set sensory inputs
-    // Food inputs (4-7)
-    // Amplify the food proximity signal with a multiplier
-    float foodProximityMultiplier = 25.0f; // Increase to make food more attractive
-    inputs[4] = (nearestFoodDist == INFINITY) ? 0.0f : fminf(1.0f, (1.0f - (nearestFoodDist / MAX_DETECTION_RANGE)) * foodProximityMultiplier);
-
-    // Amplify directional signals to make creatures navigate more purposefully toward food
-    float foodDirectionMultiplier = 25.0f; // Strengthen directional pull toward food
-    inputs[5] = (nearestFoodDist == INFINITY) ? 0.0f : (foodDir.x / nearestFoodDist) * foodDirectionMultiplier;
-    inputs[6] = (nearestFoodDist == INFINITY) ? 0.0f : (foodDir.y / nearestFoodDist) * foodDirectionMultiplier;
-
-    // Adjust hunger threshold - make creatures seek food even at higher energy levels
-    inputs[7] = c->energy < 150.0f ? (1.0f - (c->energy / 150.0f)) : 0.0f; // Progressive hunger signal
-
-    // Predator inputs (8-11)
-    inputs[8] = (nearestPredatorDist == INFINITY) ? 0.0f : 25.0f - (nearestPredatorDist / MAX_DETECTION_RANGE);
-    inputs[9] = (nearestPredatorDist == INFINITY) ? 0.0f : predatorDir.x / nearestPredatorDist;
-    inputs[10] = (nearestPredatorDist == INFINITY) ? 0.0f : predatorDir.y / nearestPredatorDist;
-    inputs[11] = c->energy < 30.0f ? 5.0f : 0.0f; // Weakness signal
-
-    // Mate inputs (12-15)
-    inputs[12] = (nearestMateDist == INFINITY) ? 0.0f : 25.0f - (nearestMateDist / MAX_DETECTION_RANGE);
-    inputs[13] = (nearestMateDist == INFINITY) ? 0.0f : mateDir.x / nearestMateDist;
-    inputs[14] = (nearestMateDist == INFINITY) ? 0.0f : mateDir.y / nearestMateDist;
-    inputs[15] = CanReproduce(c) ? 10.0f : 0.0f; // Reproduction readiness
-
-    // Environmental awareness (16)
-    inputs[16] = c->speed / 15.5f; // Normalized speed
-
-    // Process inputs through neural network's hidden layer
-    float hidden[HIDDEN];
-    for (int i = 0; i < HIDDEN; i++)
+// Mirror the creatures within GHOST_BAND of each shared border into the neighbour on that side
+void SendGhosts()
+{
+    for (CreatureNode *current = creatureList; current != NULL; current = current->next)
     {
-        float sum = c->brain.biasH[i];
-        for (int j = 0; j < INPUTS; j++)
+        Creature *c = current->data;
+        int near[TILE_SIDES] = {
+            c->position.x < GHOST_BAND,
+            c->position.x >= WINDOW_WIDTH - GHOST_BAND,
+            c->position.y < GHOST_BAND,
+            c->position.y >= WINDOW_HEIGHT - GHOST_BAND};
+        for (int side = 0; side < TILE_SIDES; side++)
         {
-            sum += c->brain.weightsIH[i][j] * inputs[j];
+            if (!near[side] || tileNeighbours[side] < 0)
+                continue;
+            GhostRecord ghost = {AcrossBorder(c->position, side), (unsigned char)c->type, (unsigned char)CanReproduce(c)};
+            RingPush(&shard->tiles[tileIndex].ghosts[side], &ghost, sizeof(ghost), NULL, 0); // Dropped if full
         }
-        hidden[i] = Activate(sum);
     }
+}
 
-    // Process hidden layer outputs to produce final outputs
-    float output[OUTPUTS];
-    for (int i = 0; i < OUTPUTS; i++)
+// Replace the local ghosts with the ones the neighbours published this tick
+void ReceiveGhosts()
+{
+    ghostCount = 0;
+    for (int side = 0; side < TILE_SIDES; side++)
     {
-        float sum = c->brain.biasO[i];
-        for (int j = 0; j < HIDDEN; j++)
+        int neighbour = tileNeighbours[side];
+        if (neighbour < 0)
+            continue;
+        ShardRing *ring = &shard->tiles[neighbour].ghosts[side ^ 1];
+        const unsigned char *record;
+        while ((record = RingPeek(ring)) != NULL)
         {
-            sum += c->brain.weightsHO[i][j] * hidden[j];
+            memcpy(&ghosts[ghostCount++], record, sizeof(GhostRecord));
+            RingPop(ring);
         }
-        output[i] = Activate(sum);
     }
+}
 
-    // Update position based on neural network output
-    // Output values are between 0-1, so subtract 0.5 to allow negative movement
-    // Update position based on neural network output
+// Simulate one tile of a sharded world in lockstep with the others (runs in a forked process)
+int RunTile(int index)
+{
+    signal(SIGINT, SIG_IGN); // The coordinator decides when every tile stops
+    signal(SIGTERM, SIG_IGN);
+    srand(config.seed ^ ((unsigned int)(index + 1) * 2654435761u));
 
-    // Check for NaN values and replace them with defaults
-    if (isnan(output[0]) || isnan(output[1]))
+    int column = index % config.tilesX;
+    int row = index / config.tilesX;
+    tileIndex = index;
+    worldOrigin = (Vector2){(float)column * WINDOW_WIDTH, (float)row * WINDOW_HEIGHT};
+    tileNeighbours[TILE_LEFT] = column > 0 ? index - 1 : -1;
+    tileNeighbours[TILE_RIGHT] = column < config.tilesX - 1 ? index + 1 : -1;
+    tileNeighbours[TILE_UP] = row > 0 ? index - config.tilesX : -1;
+    tileNeighbours[TILE_DOWN] = row < config.tilesY - 1 ? index + config.tilesX : -1;
+    ghosts = (GhostRecord *)malloc(TILE_SIDES * GHOST_RING_SIZE * sizeof(GhostRecord));
+
+    // Share the CPUs between tiles unless told otherwise
+    if (config.threads == 0)
     {
-        output[0] = 0.5f;
-        output[1] = 0.5f;
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        config.threads = cpus > shard->tileCount ? (int)(cpus / shard->tileCount) : 1;
     }
 
-    c->position.x += (output[0] - 0.5f) * c->speed;
-    c->position.y += (output[1] - 0.5f) * c->speed;
-
-    // Clamp positions to window boundaries
-    c->position.x = fminf(fmaxf(c->position.x, 32), WINDOW_WIDTH - 32);
-    c->position.y = fminf(fmaxf(c->position.y, 32), WINDOW_HEIGHT - 32);
-
-    // Calculate movement cost with validation
-    float movementX = (output[0] - 0.5f) * c->speed;
-    float movementY = (output[1] - 0.5f) * c->speed;
-
-    // Validate to avoid extreme values
-    if (isnan(movementX) || isnan(movementY))
+    // Everything allocated from here on is first touched by this process (local to its NUMA node)
+    if (!StartCreaturePool())
     {
-        movementX = 0;
-        movementY = 0;
+        ShardAbort();
+        return 1;
     }
-
-    float movementCost = fabsf(movementX) + fabsf(movementY);
-
-    // Different species have different energy efficiencies
-    float energyCost;
-    switch (c->type)
-    {
-    case RABBIT:
-        energyCost = 0.02f; // Rabbits use less energy
-        break;
-    case DUCK:
-        energyCost = 0.03f; // Ducks use slightly more energy
-        break;
-    case FOX:
-        energyCost = 0.06f; // Foxes use more energy
-        break;
-    case WOLF:
-        energyCost = 0.09f; // Wolves use the most energy
-        break;
-    }
-    c->energy -= movementCost * energyCost;
-    // Validate energy to prevent NaN
-    if (isnan(c->energy))
+    InitializeCreatures();
+    StartWorkerPool();
+    StartDiversityThread();
+    SimStats stats = {0};
+    for (;;)
     {
-        c->energy = -1; // Mark for removal
+        double updateStart = NowSeconds();
+        UpdateCreatures();
+        SendMigrants();
+        SendGhosts();
+        if (!ShardBarrier())
+            break;
+        // Every tile has finished writing its outboxes
+        ReceiveMigrants();
+        ReceiveGhosts();
+        PublishStats(&stats, NowSeconds() - updateStart, 0);
+        shard->tiles[index].stats = stats;
+        if (!ShardBarrier() || atomic_load(&shard->stop))
+            break;
     }
-
-    // Ensure energy is within reasonable bounds
-    c->energy = fminf(c->energy, 1000.0f); // Cap maximum energy
+    StopDiversityThread();
+    StopWorkerPool();
+    free(ghosts);
+    // The coordinator reports the leaks of all tiles together
+    CountLeaks(shard->tiles[index].leakedAllocs, shard->tiles[index].leakedBytes);
+    atomic_store(&shard->tiles[index].leaksCounted, 1);
+    StopCreaturePool();
+    return atomic_load(&shard->abort) ? 1 : 0;
 }
 
-// Update all creatures in the simulation for one frame
-void UpdateCreatures()
+// Combine the per-tile stats into one snapshot of the whole world
+void MergeTileStats(SimStats *merged)
 {
-    CreatureNode *current = creatureList;
-    while (current != NULL)
+    double energy[SPECIES_COUNT][2] = {{0}}, age[SPECIES_COUNT][2] = {{0}}, speed[SPECIES_COUNT][2] = {{0}};
+    double weightVariance[SPECIES_COUNT] = {0}, pairwiseDistance[SPECIES_COUNT] = {0};
+    *merged = (SimStats){0};
+    merged->tiles = shard->tileCount;
+    for (int t = 0; t < shard->tileCount; t++)
     {
-        if (current->data->type != GRASS)
-        {
-            // Create an empty array for inputs
-            float inputs[INPUTS] = {0};
-
-            // Process neural network (inputs are populated inside the function)
-            ProcessNeuralNetwork(current->data, inputs);
-        }
-        current->data->age++;
-        current->data->last_mate++;
-
-        if (current->data->type != GRASS)
-        {
-            current->data->energy -= 0.005f; // Energy cost for existing
-        }
-        // Safety validation for creature data
-        if (isnan(current->data->energy) || isnan(current->data->position.x) || isnan(current->data->position.y))
+        const SimStats *tile = &shard->tiles[t].stats;
+        merged->tick = tile->tick;
+        for (int i = 0; i < SPECIES_COUNT; i++)
         {
-            DestroyCreature(current->data);
-            return;
+            int n = tile->counts[i];
+            merged->counts[i] += n;
+            merged->births[i] += tile->births[i];
+            merged->deaths[i] += tile->deaths[i];
+            merged->birthsPerSecond[i] += tile->birthsPerSecond[i];
+            merged->deathsPerSecond[i] += tile->deathsPerSecond[i];
+            // Sums of n * mean and n * (variance + mean^2) recombine into the world moments
+            energy[i][0] += n * (double)tile->energyMean[i];
+            energy[i][1] += n * ((double)tile->energyVariance[i] + (double)tile->energyMean[i] * tile->energyMean[i]);
+            age[i][0] += n * (double)tile->ageMean[i];
+            age[i][1] += n * ((double)tile->ageVariance[i] + (double)tile->ageMean[i] * tile->ageMean[i]);
+            speed[i][0] += n * (double)tile->speedMean[i];
+            speed[i][1] += n * ((double)tile->speedVariance[i] + (double)tile->speedMean[i] * tile->speedMean[i]);
+            // Diversity is averaged over the tiles' samples (an approximation of a world-wide sample)
+            int samples = tile->diversity.samples[i];
+            merged->diversity.samples[i] += samples;
+            weightVariance[i] += samples * (double)tile->diversity.weightVariance[i];
+            pairwiseDistance[i] += samples * (double)tile->diversity.pairwiseDistance[i];
         }
-        // Check for interactions with other creatures
-        CheckInteractions(current->data);
-
-        // Remove creatures with no energy
-        if (current->data->energy <= 0)
+        merged->diversity.tick = tile->diversity.tick;
+        // Lockstep runs at the pace of the slowest tile
+        merged->ticksPerSecond = (t == 0 || tile->ticksPerSecond < merged->ticksPerSecond) ? tile->ticksPerSecond : merged->ticksPerSecond;
+        merged->updateSeconds = fmax(merged->updateSeconds, tile->updateSeconds);
+        merged->thinkSeconds = fmax(merged->thinkSeconds, tile->thinkSeconds);
+        merged->interactSeconds = fmax(merged->interactSeconds, tile->interactSeconds);
+        merged->reorders += tile->reorders;
+        merged->orderDrift = fmaxf(merged->orderDrift, tile->orderDrift);
+        merged->residentBytes += tile->residentBytes;
+        merged->creatureBytes += tile->creatureBytes;
+        for (int i = 0; i < ALLOC_KIND_COUNT; i++)
         {
-            DestroyCreature(current->data);
-            return;
+            merged->allocs[i] += tile->allocs[i];
+            merged->frees[i] += tile->frees[i];
+            merged->liveBytes[i] += tile->liveBytes[i];
         }
-        current = current->next;
+        merged->allocsLastTick += tile->allocsLastTick;
+        merged->freesLastTick += tile->freesLastTick;
+        merged->ghosts += tile->ghosts;
+        merged->migrations += tile->migrations;
+        merged->migrationsBlocked += tile->migrationsBlocked;
+        merged->poolCapacity += tile->poolCapacity;
+        merged->poolUsed += tile->poolUsed;
+        merged->spawnsRefused += tile->spawnsRefused;
     }
-
-    // Add random grass
-    if ((float)rand() / RAND_MAX < 0.06f)
+    for (int i = 0; i < SPECIES_COUNT; i++)
     {
-        Creature *grass = (Creature *)malloc(sizeof(Creature));
-        grass->position = (Vector2){50 + rand() % (WINDOW_WIDTH - 100), 50 + rand() % (WINDOW_HEIGHT - 100)};
-        grass->speed = 0;
-        grass->energy = 30;
-        grass->type = GRASS;
-        grass->age = 0;
-        grass->last_mate = 0;
-        grass->color = DARKGREEN;
-        AddCreature(grass);
+        Moments(merged->counts[i], energy[i][0], energy[i][1], &merged->energyMean[i], &merged->energyVariance[i]);
+        Moments(merged->counts[i], age[i][0], age[i][1], &merged->ageMean[i], &merged->ageVariance[i]);
+        Moments(merged->counts[i], speed[i][0], speed[i][1], &merged->speedMean[i], &merged->speedVariance[i]);
+        if (merged->diversity.samples[i] > 0)
+        {
+            merged->diversity.weightVariance[i] = (float)(weightVariance[i] / merged->diversity.samples[i]);
+            merged->diversity.pairwiseDistance[i] = (float)(pairwiseDistance[i] / merged->diversity.samples[i]);
+        }
     }
+    merged->residentBytes += ReadResidentBytes(); // The coordinator itself
+    // The processes peak at different times, so their peaks do not add up: keep the highest total seen
+    static long long peakResident = 0, peakCreature = 0;
+    if (merged->residentBytes > peakResident)
+        peakResident = merged->residentBytes;
+    if (merged->creatureBytes > peakCreature)
+        peakCreature = merged->creatureBytes;
+    merged->peakResidentBytes = peakResident;
+    merged->peakCreatureBytes = peakCreature;
 }
 
-// Draw all creatures to the screen
-void DrawCreatures()
+// Run a sharded headless world: fork one process per tile and step them in lockstep
+int RunSharded()
 {
-    CreatureNode *current = creatureList;
-    while (current != NULL)
-    {
-        // Draw energy level as text
-        DrawText(TextFormat("e:%.0f a:%d", current->data->energy, current->data->age),
-                 (int)(current->data->position.x - 17),
-                 (int)(current->data->position.y + 17),
-                 10,
-                 current->data->color);
+    int tileCount = config.tilesX * config.tilesY;
+    if (!MapShard(tileCount))
+        return 1;
+    coordinatorPid = getpid();
+    worldSize = (Vector2){(float)config.tilesX * WINDOW_WIDTH, (float)config.tilesY * WINDOW_HEIGHT};
+    printf("Sharded world: %dx%d tiles of %dx%d\n", config.tilesX, config.tilesY, WINDOW_WIDTH, WINDOW_HEIGHT);
+    fflush(stdout); // Forked tiles would repeat anything still buffered
 
-        // Draw creature based on type
-        switch (current->data->type)
+    pid_t tiles[MAX_TILES];
+    int started = 0;
+    for (; started < tileCount; started++)
+    {
+        tiles[started] = fork();
+        if (tiles[started] == 0)
         {
-        case RABBIT:
-            DrawTexturePro(RabbitIcon,
-                           (Rectangle){0, 0, RabbitIcon.width, RabbitIcon.height},
-                           (Rectangle){current->data->position.x - 16, current->data->position.y - 16, 32, 32},
-                           (Vector2){0, 0}, 0, WHITE);
-            break;
-        case DUCK:
-            DrawTexturePro(DuckIcon,
-                           (Rectangle){0, 0, DuckIcon.width, DuckIcon.height},
-                           (Rectangle){current->data->position.x - 16, current->data->position.y - 16, 32, 32},
-                           (Vector2){0, 0}, 0, WHITE);
+            int result = RunTile(started);
+            fflush(stdout);
+            _exit(result);
+        }
+        if (tiles[started] < 0)
+        {
+            fprintf(stderr, "Shard: cannot start tile %d: %s\n", started, strerror(errno));
+            ShardAbort();
             break;
-        case FOX:
-            DrawTexturePro(FoxIcon,
-                           (Rectangle){0, 0, FoxIcon.width, FoxIcon.height},
-                           (Rectangle){current->data->position.x - 16, current->data->position.y - 16, 32, 32},
-                           (Vector2){0, 0}, 0, WHITE);
+        }
+    }
+
+    // The metrics thread is started after forking so that no tile inherits it
+    signal(SIGINT, HandleStopSignal);
+    signal(SIGTERM, HandleStopSignal);
+    if (config.metricsPort > 0 || config.metricsSocket != NULL)
+        StartMetricsServer();
+    SimStats stats = {0};
+    double start = NowSeconds();
+    long long ticks = 0;
+    while (!atomic_load(&shard->abort))
+    {
+        // Between the barriers the tiles drain their inboxes; the stop flag is read after the second one
+        if (!ShardBarrier())
             break;
-        case WOLF:
-            DrawTexturePro(WolfIcon,
-                           (Rectangle){0, 0, WolfIcon.width, WolfIcon.height},
-                           (Rectangle){current->data->position.x - 16, current->data->position.y - 16, 32, 32},
-                           (Vector2){0, 0}, 0, WHITE);
+        ticks++;
+        if (!keepRunning || (config.maxTicks > 0 && ticks >= config.maxTicks))
+            atomic_store(&shard->stop, 1);
+        if (!ShardBarrier())
             break;
-        case GRASS:
-            DrawTexturePro(GrassIcon,
-                           (Rectangle){0, 0, GrassIcon.width, GrassIcon.height},
-                           (Rectangle){current->data->position.x - 16, current->data->position.y - 16, 32, 32},
-                           (Vector2){0, 0}, 0, WHITE);
+        MergeTileStats(&stats);
+        WriteStats(&stats);
+        if (atomic_load(&shard->stop))
             break;
-        }
-        current = current->next;
     }
-    for (size_t i = 0; i < MAX_HEARTH_EFFECTS; i++)
+
+    int failed = atomic_load(&shard->abort);
+    for (int t = 0; t < started; t++)
+        waitpid(tiles[t], NULL, 0);
+    StopMetricsServer();
+    if (failed)
+        fprintf(stderr, "Shard: a tile process exited early, run aborted\n");
+    PrintSummary(&stats, NowSeconds() - start);
+
+    // One leak report for the whole world
+    long long leakedAllocs[ALLOC_KIND_COUNT] = {0}, leakedBytes[ALLOC_KIND_COUNT] = {0};
+    int unreported = 0;
+    for (int t = 0; t < started; t++)
     {
-        if (hearthEffects[i].age > 0 && hearthEffects[i].age < 500)
+        const TileShared *tile = &shard->tiles[t];
+        if (!atomic_load(&tile->leaksCounted))
         {
-            DrawText("sex", hearthEffects[i].position.x, hearthEffects[i].position.y, 20, RED);
-            hearthEffects[i].age++;
+            unreported++;
+            continue;
         }
-        else if (hearthEffects[i].age >= 500)
+        for (int i = 0; i < ALLOC_KIND_COUNT; i++)
         {
-            hearthEffects[i].age = 0;
-            hearthEffects[i].position = (Vector2){0, 0};
+            leakedAllocs[i] += tile->leakedAllocs[i];
+            leakedBytes[i] += tile->leakedBytes[i];
         }
     }
+    PrintLeaks(leakedAllocs, leakedBytes);
+    if (unreported > 0)
+        printf("Leak check: %d of %d tiles exited without reporting\n", unreported, started);
+    munmap(shard, shardBytes);
+    shard = NULL;
+    return failed ? 1 : 0;
+}
+
+// Run the simulation without a window until interrupted or the tick limit is reached
+int RunHeadless()
+{
+    signal(SIGINT, HandleStopSignal);
+    signal(SIGTERM, HandleStopSignal);
+    config.frameBudgetMs = 0; // The governor only runs in interactive mode
+
+    if (!StartCreaturePool())
+        return 1;
+    InitializeCreatures();
+    printf("Creatures initialized\n");
+    printf("Creatures: %d\n", POP_SIZE);
+
+    StartWorkerPool();
+    StartDiversityThread();
+    if (config.captureEvery > 0)
+        StartCapture();
+    SimStats stats = {0};
+    double start = NowSeconds();
+    while (keepRunning && (config.maxTicks == 0 || simTick < config.maxTicks))
+    {
+        double updateStart = NowSeconds();
+        UpdateCreatures();
+        if (CaptureDue())
+            CaptureSnapshot();
+        PublishStats(&stats, NowSeconds() - updateStart, 0);
+    }
+    StopCapture();
+    StopDiversityThread();
+    StopWorkerPool();
+    stats.framesCaptured = atomic_load(&framesCaptured);
+    stats.residentBytes = ReadResidentBytes();
+    stats.peakResidentBytes = ReadPeakResidentBytes();
+    PrintSummary(&stats, NowSeconds() - start);
+    ReportLeaks();
+    StopCreaturePool();
+    return 0;
 }
 
 // Main program entry point
-int main()
+int main(int argc, char **argv)
 {
+    if (!ParseArguments(argc, argv))
+    {
+        return 1;
+    }
+    SetupFoodWeb();
+    if (config.tilesX * config.tilesY > 1)
+    {
+        return RunSharded(); // Starts its own metrics server once the tiles are forked
+    }
+    if (config.metricsPort > 0 || config.metricsSocket != NULL)
+    {
+        StartMetricsServer();
+    }
+    if (config.headless)
+    {
+        srand(config.seed); // Seed the random number generator
+        int result = RunHeadless();
+        StopMetricsServer();
+        return result;
+    }
+
     // Initialize the window
     SetConfigFlags(FLAG_WINDOW_RESIZABLE);
     // SetConfigFlags(FLAG_FULLSCREEN_MODE);
     InitWindow(WINDOW_WIDTH, WINDOW_HEIGHT, "Evolution Simulator");
-    srand(time(NULL)); // Seed the random number generator
+    srand(config.seed); // Seed the random number generator
 
     // Load textures
-    RabbitIcon = LoadTexture("./assets/rabbit.png");
-    DuckIcon = LoadTexture("./assets/duck.png");
-    FoxIcon = LoadTexture("./assets/fox.png");
-    WolfIcon = LoadTexture("./assets/wolf.png");
-    GrassIcon = LoadTexture("./assets/grass.png");
+    for (int i = 0; i < SPECIES_COUNT; i++)
+        speciesIcons[i] = LoadTexture(speciesTable[i].iconPath);
 
     // Setup the initial population
+    if (!StartCreaturePool())
+    {
+        CloseWindow();
+        return 1;
+    }
     InitializeCreatures();
+    StartWorkerPool();
+    StartDiversityThread();
+    if (config.captureEvery > 0)
+        StartCapture();
     printf("Creatures initialized\n");
     printf("Creatures: %d\n", POP_SIZE);
     SetTargetFPS(240); // Higher FPS for faster simulation
@@ -784,7 +4118,11 @@ int main()
     static Species selectedSpecies = -1;
     static int dragEnabled = 0;
     static int cloneEnabled = 0;
+    static int historyEnabled = 1;
     static Creature *draggedCreature = NULL;
+    RegisterCreatureHandle(&draggedCreature);
+    static SimStats stats = {0};
+    double drawSeconds = 0;
 
     // Main game loop
     while (!WindowShouldClose())
@@ -792,27 +4130,47 @@ int main()
         BeginDrawing();
         ClearBackground(RAYWHITE);
 
-        // Update and render all creatures
-        UpdateCreatures();
-        DrawCreatures();
-        // Count creatures by type
-        int counts[5] = {0}; // RABBIT, DUCK, FOX, WOLF, GRASS
-        CreatureNode *countCurrent = creatureList;
-        while (countCurrent != NULL)
-        {
-            if (countCurrent->data->type < 5)
-            { // Safety check
-                counts[countCurrent->data->type]++;
-            }
-            countCurrent = countCurrent->next;
-        }
+        // Update and render all creatures (the governor picks how many ticks fit in the frame)
+        int captureFrame = 0;
+        double frameStart = NowSeconds();
+        double updateSeconds = 0;
+        for (int tick = 0; tick < governor.ticksPerFrame; tick++)
+        {
+            double updateStart = NowSeconds();
+            UpdateCreatures();
+            updateSeconds = NowSeconds() - updateStart;
+            captureFrame |= CaptureDue();
 
+            // Publish stats (counts are kept up to date incrementally)
+            PublishStats(&stats, updateSeconds, drawSeconds);
+            RecordHistory(stats.tick, stats.counts);
+        }
+        double drawStart = NowSeconds();
+        if (captureFrame)
+        {
+            // Render the world offscreen, show it, and hand the pixels to the capture thread
+            BeginTextureMode(captureTarget);
+            ClearBackground(RAYWHITE);
+            DrawCreatures();
+            EndTextureMode();
+            DrawTextureRec(captureTarget.texture, (Rectangle){0, 0, WINDOW_WIDTH, -WINDOW_HEIGHT}, (Vector2){0, 0}, WHITE);
+            CaptureRenderTexture();
+        }
+        else
+        {
+            DrawCreatures();
+        }
+        if (historyEnabled)
+            DrawPopulationHistory((Rectangle){10, WINDOW_HEIGHT - 240, 480, 180});
+        drawSeconds = NowSeconds() - drawStart;
+        UpdateGovernor(drawStart - frameStart, governor.ticksPerFrame, drawSeconds);
         // Display population statistics
-        DrawText(TextFormat("Rabbits: %d", counts[RABBIT]), 10, 10, 20, GREEN);
-        DrawText(TextFormat("Ducks: %d", counts[DUCK]), 10, 35, 20, BLUE);
-        DrawText(TextFormat("Foxes: %d", counts[FOX]), 10, 60, 20, ORANGE);
-        DrawText(TextFormat("Wolves: %d", counts[WOLF]), 10, 85, 20, RED);
-        DrawText(TextFormat("Grass: %d", counts[GRASS]), 10, 110, 20, DARKGREEN);
+        for (int i = 0; i < SPECIES_COUNT; i++)
+        {
+            DrawText(stats.diversity.strategies[i] > 1 ? TextFormat("%s: %d (%d strategies)", speciesTable[i].label, stats.counts[i], stats.diversity.strategies[i])
+                                                       : TextFormat("%s: %d", speciesTable[i].label, stats.counts[i]),
+                     10, 10 + 25 * i, 20, speciesTable[i].color);
+        }
 
         // Define button areas
         Rectangle rabbitBtn = {200, 10, 100, 20};
@@ -822,6 +4180,8 @@ int main()
         Rectangle clearBtn = {200, 110, 100, 20};
         Rectangle toggleDragBtn = {200, 135, 100, 20};
         Rectangle toggleCloneBtn = {200, 160, 100, 20};
+        Rectangle toggleHistoryBtn = {200, 185, 100, 20};
+        Rectangle toggleTintBtn = {200, 210, 100, 20};
 
         // Draw buttons
         DrawRectangleRec(rabbitBtn, LIGHTGRAY);
@@ -831,6 +4191,8 @@ int main()
         DrawRectangleRec(clearBtn, LIGHTGRAY);
         DrawRectangleRec(toggleDragBtn, dragEnabled ? GRAY : LIGHTGRAY);
         DrawRectangleRec(toggleCloneBtn, cloneEnabled ? GRAY : LIGHTGRAY);
+        DrawRectangleRec(toggleHistoryBtn, historyEnabled ? GRAY : LIGHTGRAY);
+        DrawRectangleRec(toggleTintBtn, strategyTint ? GRAY : LIGHTGRAY);
 
         DrawText("Add Rabbit", 205, 12, 16, GREEN);
         DrawText("Add Duck", 205, 37, 16, BLUE);
@@ -839,6 +4201,8 @@ int main()
         DrawText("Clear Selection", 205, 112, 16, MAROON);
         DrawText("Toggle Drag", 205, 137, 16, MAROON);
         DrawText("Toggle Cloning", 205, 162, 16, MAROON);
+        DrawText("Toggle Graph", 205, 187, 16, MAROON);
+        DrawText("Tint Strategies", 205, 212, 16, MAROON);
 
         Vector2 mousePos = GetMousePosition();
 
@@ -885,7 +4249,9 @@ int main()
                                        powf(mousePos.y - current->data->position.y, 2));
                     if (dist < 32)
                     { // Assuming creature radius is 32
-                        Creature *newCreature = (Creature *)malloc(sizeof(Creature));
+                        Creature *newCreature = AllocCreature(CreatureAllocKind(current->data->type));
+                        if (newCreature == NULL)
+                            break; // Population cap reached
                         newCreature->position = (Vector2){
                             50 + rand() % (WINDOW_WIDTH - 100),
                             50 + rand() % (WINDOW_HEIGHT - 100)};
@@ -896,22 +4262,15 @@ int main()
                         newCreature->speed = current->data->speed;
                         newCreature->color = current->data->color;
 
-                        // Deep copy of the neural network
-                        for (int i = 0; i < HIDDEN; i++)
+                        // Deep copy of the neural network (grass has none)
+                        if (current->data->brain.genes == NULL)
                         {
-                            for (int j = 0; j < INPUTS; j++)
-                            {
-                                newCreature->brain.weightsIH[i][j] = current->data->brain.weightsIH[i][j];
-                            }
-                            newCreature->brain.biasH[i] = current->data->brain.biasH[i];
+                            newCreature->brain = (NeuralNetwork){0};
                         }
-                        for (int i = 0; i < OUTPUTS; i++)
+                        else
                         {
-                            for (int j = 0; j < HIDDEN; j++)
-                            {
-                                newCreature->brain.weightsHO[i][j] = current->data->brain.weightsHO[i][j];
-                            }
-                            newCreature->brain.biasO[i] = current->data->brain.biasO[i];
+                            AllocateNetwork(&newCreature->brain);
+                            memcpy(newCreature->brain.genes, current->data->brain.genes, topology.genomeLength * sizeof(float));
                         }
 
                         AddCreature(newCreature);
@@ -939,41 +4298,30 @@ int main()
                 dragEnabled = !dragEnabled;
             else if (CheckCollisionPointRec(mousePos, toggleCloneBtn))
                 cloneEnabled = !cloneEnabled;
+            else if (CheckCollisionPointRec(mousePos, toggleHistoryBtn))
+                historyEnabled = !historyEnabled;
+            else if (CheckCollisionPointRec(mousePos, toggleTintBtn))
+                strategyTint = !strategyTint;
             else if (selectedSpecies != -1 && !dragEnabled)
             {
-                // Create new creature at click location
-                Creature *newCreature = (Creature *)malloc(sizeof(Creature));
-                newCreature->position = mousePos;
-                newCreature->type = selectedSpecies;
-                newCreature->age = 0;
-                newCreature->last_mate = 0;
-
-                switch (selectedSpecies)
+                // Create new creature at click location (unless the population cap is reached)
+                Creature *newCreature = AllocCreature(ALLOC_CREATURE);
+                if (newCreature != NULL)
                 {
-                case RABBIT:
-                    newCreature->energy = RABBIT_STARTENERGY;
-                    newCreature->speed = 2.5f;
-                    newCreature->color = GREEN;
-                    break;
-                case DUCK:
-                    newCreature->energy = DUCK_STARTENERGY;
-                    newCreature->speed = 1.5f;
-                    newCreature->color = BLUE;
-                    break;
-                case FOX:
-                    newCreature->energy = FOX_STARTENERGY;
-                    newCreature->speed = 1.2f;
-                    newCreature->color = ORANGE;
-                    break;
-                case WOLF:
-                    newCreature->energy = WOLF_STARTENERGY;
-                    newCreature->speed = 1.0f;
-                    newCreature->color = RED;
-                    break;
-                }
+                    newCreature->position = mousePos;
+                    newCreature->type = selectedSpecies;
+                    newCreature->age = 0;
+                    newCreature->last_mate = 0;
 
-                InitializeNetwork(&newCreature->brain);
-                AddCreature(newCreature);
+                    const SpeciesInfo *species = &speciesTable[selectedSpecies];
+                    newCreature->energy = species->startEnergy;
+                    newCreature->speed = species->placedSpeed;
+                    newCreature->color = species->color;
+
+                    AllocateNetwork(&newCreature->brain);
+                    InitializeNetwork(&newCreature->brain);
+                    AddCreature(newCreature);
+                }
             }
         }
 
@@ -984,11 +4332,31 @@ int main()
         }
 
         DrawText(TextFormat("FPS: %d", GetFPS()), WINDOW_WIDTH - 100, 40, 20, LIME);
+        DrawText(TextFormat("Memory: %.0f KB live (peak %.0f KB), RSS %.1f MB (peak %.1f MB), %d allocs / %d frees last tick%s",
+                            stats.creatureBytes / 1024.0, stats.peakCreatureBytes / 1024.0,
+                            stats.residentBytes / 1048576.0, stats.peakResidentBytes / 1048576.0,
+                            stats.allocsLastTick, stats.freesLastTick,
+                            stats.poolCapacity > 0 ? TextFormat(", pool %d/%d, %lld refused", stats.poolUsed, stats.poolCapacity, stats.spawnsRefused) : ""),
+                 10, WINDOW_HEIGHT - 45, 16, DARKGRAY);
+        if (config.frameBudgetMs > 0)
+        {
+            DrawText(TextFormat("Governor: %d ticks/frame, grass x%.2f, cap %s, %lld adjustments, %lld births / %lld grass withheld",
+                                governor.ticksPerFrame, governor.grassSpawnScale,
+                                governor.softCap > 0 ? TextFormat("%d", governor.softCap) : "off",
+                                governor.adjustments, governor.birthsSuppressed, governor.grassSuppressed),
+                     10, WINDOW_HEIGHT - 25, 16, DARKGRAY);
+        }
 
         EndDrawing();
     }
 
     // Cleanup
+    StopCapture();
+    StopDiversityThread();
+    StopWorkerPool();
+    ReportLeaks();
+    StopCreaturePool();
+    StopMetricsServer();
     CloseWindow();
     return 0;
 }
\ No newline at end of file